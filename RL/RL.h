@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include "include.h"
+#include "stream.h"
+#include "replay_log.h"
 
 class SlottedAlohaRL_MC {
 public:
@@ -15,14 +17,76 @@ public:
         }
     }
     void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    // run every iteration and average the results without plotting
+    void train() {
+        // restart the engine so every iteration begins from a known seed
+        set_seed(get_seed());
         init();
-        for (int i = 0; i < iterations_target; i++) {
+        for (int i = 0; i < iterations; i++) {
+            log_iteration();
             run_iteration();
             change_seed();
             reset(true);
         }
         calc_average();
-        plot();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+    // Long-horizon mode: one continuous iteration of `episodes` episodes
+    // summarized into fixed-size Stream_Data instead of Plot_Data
+    void run_stream(unsigned int episodes) {
+        init();
+        stream.reset();
+        streaming = true;
+        for (episode_num = 0; episode_num < episodes; episode_num++) {
+            run_episode();
+        }
+        streaming = false;
+        reset(true);
+        plot_stream();
+    }
+
+    // Write every seed, action and reward of the following runs into `log`
+    void set_replay_log(Replay_Writer* log) {
+        replay_log = log;
+    }
+
+    // Replay interface (see replay_log.h)
+    void replay_iteration(unsigned int seed, const std::vector<double>& Q) {
+        set_seed(seed);
+        for (auto& node : nodes) {
+            node.reset(true);
+            node.Q = Map<const RowVectorXd>(Q.data() + node.node_num * NumSlot, NumSlot);
+        }
+    }
+    void replay_episode(unsigned int episode, const Replay_Action&) {
+        episode_num = episode;
+    }
+    void replay_frame(const Replay_Action& action, const Replay_Reward& reward, const Replay_Mask& active) {
+        for (auto& node : nodes) {
+            ++node.num_visit[action[node.node_num]];
+        }
+        learn(action, reward, active);
+    }
+    void replay_episode_end(const Replay_Reward& reward) {
+        average();
+        learn_final(reward);
+        cur_reward = 0;
+        for (auto& node : nodes) {
+            node.reset(false);
+        }
+    }
+    const RowVectorXd& get_Q(int node_num) const {
+        return nodes[node_num].Q;
     }
 
 
@@ -38,12 +102,12 @@ private:
         Node(const int& _node_num) : node_num(_node_num) {}
         RowVectorXd Q = RowVectorXd::Random(NumSlot);
         unsigned int node_num;
-        unsigned int remaining_data = 10;
-        bool is_success;
+        unsigned int remaining_data = data_target;
+        bool is_success = false;
         std::array<int, NumSlot> num_visit = { 0 };
 
         void reset(bool iteration_end) {
-            remaining_data = 10;
+            remaining_data = data_target;
             is_success = false;
             std::fill(num_visit.begin(), num_visit.end(), 0);
             if (iteration_end) {
@@ -55,6 +119,8 @@ private:
     typedef std::array<int, NumNode> State;
     typedef std::array<int, NumNode> Action;
     typedef std::array<Node, NumNode> NodeArr;
+    typedef std::array<double, NumNode> Reward;
+    typedef std::array<bool, NumNode> Mask;
 
     void init() {
         for (auto& node : nodes) {
@@ -64,60 +130,47 @@ private:
     void run_iteration() {
         // iterate episodes
         for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
-#ifdef DEBUG
-            cout << "Episode #" << episode_num << ":" << endl;
-#endif 
-            // choose action and update Q matrix every step
-            for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
-                choose_action();
-                render(frame_num);
-            }
-
-            update();
-            // figure out if every node has successfully finished their transmissions
-            bool is_complete = true;
-            for (auto node : nodes) {
-                node.is_success ? ++success_node : is_complete = false;
-            }
-            data.success_data[episode_num] += success_data;
-            data.success_node[episode_num] += success_node;
-            success_data = 0;
-            success_node = 0;
-            final_reward();
-            data.cum_reward[episode_num] += cur_reward;
-            cur_reward = 0;
-           
-            for (auto& node : nodes) {
-                node.reset(false);
-            }
+            run_episode();
+        }
+        step_num = 0;
+    }
 
-#ifdef DEBUG
-            cout << "Final policy matrix" << endl;
-            for (auto node : nodes) {
-                cout << std::setprecision(3) << std::fixed << node.Q << endl;
-            }
+    // A single episode: frame_num_target frames followed by the MC update
+    void run_episode() {
+        if (replay_log) replay_log->episode(episode_num, Action());
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        // choose action and update Q matrix every step
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            choose_action();
+            render(frame_num);
+        }
 
-            if (!is_complete) {
-                cout << "Could not finish transmitting data in " << frame_num_target << " frames." << endl;
-                ++total_failure;
-            }
-            else {
-                cout << "Finished transmitting in " << frame_num << " frames." << endl;
-                ++total_success;
-            }
-            cout << "Total Success: " << total_success << endl;
-            cout << "Total Failure: " << total_failure << endl;
-#endif
+        update();
+        // success_node counts nodes as they finish (see check_collision)
+        bool is_complete = success_node == NumNode;
+        is_complete ? ++total_success : ++total_failure;
+        trace_policy();
+        TRACE_COUNTER(1, "total_success", total_success);
+        TRACE_COUNTER(1, "total_failure", total_failure);
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+        final_reward();
+        record_episode();
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+       
+        for (auto& node : nodes) {
+            node.reset(false);
         }
-        step_num = 0;
     }
     // Choose an action based on the given state
-    // and save returned actions to a vector according to MC algorithm
+    // and write it to the frame's entry of `returns` for the MC update
     void choose_action() {
-        Action temp_action;
+        PROFILE_SCOPE(Choose_Action);
+        Action& temp_action = returns[frame_num];
         for (auto& node : nodes) {
             //random action
-            if (epsilon / episode_num >= get_rand_real(0, 1)) {
+            if (explore[episode_num] >= get_rand_real(0, 1)) {
                 auto random_num = get_rand_int(0, NumSlot - 1);
                 temp_action[node.node_num] = random_num;
                 ++node.num_visit[random_num];
@@ -130,40 +183,60 @@ private:
                 ++node.num_visit[index];
             }
         }
-        now = temp_action;
-        returns.push_back(temp_action);
     }
 
     // Update Q matrix based on MC algorithm
     void update() {
-        int reward;
-        for (auto action : returns) {
-            for (auto& node : nodes) {
-                if (node.remaining_data != 0) {
-                    auto nn = node.node_num;
-                    // collision X
-                    if (std::count(action.begin(), action.end(), action[nn]) == 1) {
-                        reward = positive_feedback;
-                        --node.remaining_data;
-                        ++success_data;
-                        ++success_frame;
-                        if (node.remaining_data == 0) {
-                            node.is_success = true;
-                        }
-                    }
-                    // collision O
-                    else {
-                        reward = negative_feedback;
+        for (const auto& action : returns) {
+            Reward reward = { 0.0 };
+            Mask active = { false };
+            check_collision(action, reward, active);
+            learn(action, reward, active);
+            if (replay_log) replay_log->frame(action, reward, active);
+            record_frame();
+            success_frame = 0;
+        }
+        average();
+    }
+
+    // rewards of nodes that still have data to send
+    void check_collision(const Action& action, Reward& reward, Mask& active) {
+        PROFILE_SCOPE(Collision);
+        double idle = rewards.idle(action);
+        for (auto& node : nodes) {
+            if (node.remaining_data != 0) {
+                auto nn = node.node_num;
+                active[nn] = true;
+                // collision X
+                bool success = std::count(action.begin(), action.end(), action[nn]) == 1;
+                if (success) {
+                    --node.remaining_data;
+                    ++success_data;
+                    ++success_frame;
+                    if (node.remaining_data == 0) {
+                        node.is_success = true;
+                        ++success_node;
                     }
-                    node.Q(action[nn]) += reward;
-                    cur_reward += reward;
                 }
+                reward[nn] = rewards.step(success, node.remaining_data) + idle;
+            }
+        }
+    }
+
+    void learn(const Action& action, const Reward& reward, const Mask& active) {
+        PROFILE_SCOPE(Update);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (active[nn]) {
+                node.Q(action[nn]) += reward[nn];
+                cur_reward += reward[nn];
             }
-            data.success_frame[frame_num_data++] += success_frame;
-            success_frame = 0;
         }
-        returns.clear();
-        // make an average out of all rewards
+    }
+
+    // make an average out of all rewards
+    void average() {
+        PROFILE_SCOPE(Update);
         for (auto& node : nodes) {
             int i = 0;
             for (auto& q : node.Q) {
@@ -177,32 +250,81 @@ private:
     // distribute rewards at the end of an episode based on 
     // whether a node has finised transmission or not
     void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        Reward reward;
+        double bonus = rewards.episode_bonus(nodes);
+        for (auto& node : nodes) {
+            reward[node.node_num] = rewards.final(node.is_success, bonus);
+        }
+        learn_final(reward);
+        if (replay_log) replay_log->episode_end(reward);
+    }
+
+    void learn_final(const Reward& reward) {
         for (auto& node : nodes) {
             int index = 0;
             node.Q.maxCoeff(&index);
-            if (node.is_success) {
-                node.Q[index] += episode_success;
-                cur_reward += episode_success;
-            }
-            else {
-                node.Q[index] += episode_failure;
-                cur_reward += episode_failure;
-            }
+            node.Q[index] += reward[node.node_num];
+            cur_reward += reward[node.node_num];
+        }
+    }
+
+    void log_iteration() {
+        if (!replay_log) return;
+        std::vector<double> Q(NumNode * NumSlot);
+        for (auto& node : nodes) {
+            Map<RowVectorXd>(Q.data() + node.node_num * NumSlot, NumSlot) = node.Q;
         }
+        replay_log->iteration(get_seed(), Q);
     }
 
 
-    // rendering which node decided to transmit on which slot
+    // trace which node decided to transmit on which slot
     void render(int step) {
-#ifdef DEBUG
-        printf("Step #%d ", step);
-        for (auto i : now) {
-            printf("%2d ", i);
+        TRACE_INSTANT(2, "frame", "step", step);
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "action", "node", node.node_num, "slot", returns[step][node.node_num]);
         }
-        printf("\n");
 #endif
     }
 
+    // trace the greedy slot of every node
+    void trace_policy() {
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            int index = 0;
+            node.Q.maxCoeff(&index);
+            TRACE_INSTANT(3, "policy", "node", node.node_num, "slot", index);
+        }
+#endif
+    }
+
+    // per-step and per-episode results go to Plot_Data, or to Stream_Data in long-horizon mode
+    void record_frame() {
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        if (streaming) {
+            stream.success_frame.push(success_frame);
+        }
+        else {
+            data.success_frame[frame_num_data++] += success_frame;
+        }
+    }
+
+    void record_episode() {
+        if (streaming) {
+            stream.success_data.push(success_data);
+            stream.success_node.push(success_node);
+            stream.cum_reward.push(cur_reward);
+            ++stream.episodes;
+        }
+        else {
+            data.success_data[episode_num] += success_data;
+            data.success_node[episode_num] += success_node;
+            data.cum_reward[episode_num] += cur_reward;
+        }
+    }
+
     void plot() {
         //plt::subplot(1, 3, 1);
         //plt::title("Success Frame");
@@ -223,12 +345,25 @@ private:
         plt::legend();
     }
 
+    void plot_stream() {
+        std::vector<double> x, y;
+        stream.cum_reward.trace.get(x, y);
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, x, y);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+        cout << plot_str << " rolling mean of last " << stream_window << " episodes: "
+             << std::setprecision(3) << std::fixed << stream.cum_reward.rolling.mean() << endl;
+    }
+
     // average of data
     void calc_average() {
-        std::for_each(data.success_frame.begin(), data.success_frame.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.success_data.begin(), data.success_data.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.success_node.begin(), data.success_node.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [](double& val) {val = val / iterations_target; });
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
     }
 
     void reset(bool episode_end) {
@@ -241,9 +376,13 @@ private:
 
     std::string plot_str;
     NodeArr nodes;
-    std::vector<Action> returns;
-    Action now;
+    std::array<Action, frame_num_target> returns;    // actions of every frame of the episode
     Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+    Stream_Data stream;
+    bool streaming = false;
+    Replay_Writer* replay_log = nullptr;
 
     int success_frame = 0;
     int success_data = 0;
@@ -251,6 +390,7 @@ private:
 
 
     double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
 
     double cur_reward = 0;
 
@@ -1 +1,8 @@
-#include "TD.h"
\ No newline at end of file
+#include "TD.h"
+
+template class SlottedAlohaRL_TD<double>;
+template class SlottedAlohaRL_TD<float>;
+template class SlottedAlohaRL_TD<Fixed16<>>;
+template class SlottedAlohaRL_TD<double, TD_Target::Q_Learning>;
+template class SlottedAlohaRL_TD<double, TD_Target::Expected_Sarsa>;
+template class SlottedAlohaRL_TD<double, TD_Target::Double_Q>;
@@ -1,29 +1,141 @@
 ﻿#pragma once
 #include "include.h"
+#include "stream.h"
+#include "replay_log.h"
+#include "q_value.h"
+#include "experience.h"
 
+// Bootstrap target of the one-step TD update
+enum class TD_Target {
+    Sarsa,              // r + gamma * Q(a')
+    Q_Learning,         // r + gamma * max Q
+    Expected_Sarsa,     // r + gamma * E[Q] under the epsilon-greedy policy
+    Double_Q,           // two Q matrices, each evaluated at the other's greedy slot
+};
+
+inline std::string td_target_name(TD_Target target) {
+    switch (target) {
+    case TD_Target::Q_Learning: return "Q-learning";
+    case TD_Target::Expected_Sarsa: return "Expected SARSA";
+    case TD_Target::Double_Q: return "Double Q";
+    default: return "TD";
+    }
+}
+
+// Value selects how Q matrices are stored (double, float or Fixed16, see q_value.h)
+template <typename Value = double, TD_Target Target = TD_Target::Sarsa>
 class SlottedAlohaRL_TD {
 public:
+    typedef Q_Traits<Value> Traits;
+    typedef typename Traits::real Real;
+
     SlottedAlohaRL_TD(const double& epsilon) :
         epsilon(epsilon)
     {
         std::stringstream stream;
         stream << std::fixed << std::setprecision(2) << epsilon;
-        plot_str = "TD(e=" + stream.str() + ")";
+        plot_str = td_target_name(Target) + "(e=" + stream.str() + ")";
+        if (!std::is_same<Value, double>::value) {
+            plot_str += "[" + Traits::name() + "]";
+        }
         int i = 0;
         for (auto& node : nodes) {
             node.node_num = i++;
         }
     }
     void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    // run every iteration and average the results without plotting
+    void train() {
+        train_until(iterations, 0.0);
+    }
+    // run whole iterations until `seconds` of wall-clock time are used up, at least one
+    // A budget that is not positive runs exactly one, train_until() would read it as no limit.
+    void train_for(double seconds) {
+        train_until(seconds > 0 ? std::numeric_limits<int>::max() : 1, seconds);
+    }
+    // Long-horizon mode: one continuous iteration of `episodes` episodes
+    // summarized into fixed-size Stream_Data instead of Plot_Data
+    void run_stream(unsigned int episodes) {
         std::ios::sync_with_stdio(false);
         init();
-        for (int i = 0; i < iterations_target; i++) {
-            run_iteration();
-            change_seed();
-            reset(true);
+        optimistic_start();
+        stream.reset();
+        streaming = true;
+        for (episode_num = 0; episode_num < episodes; episode_num++) {
+            run_episode();
         }
-        calc_average();
-        plot();
+        streaming = false;
+        reset(true);
+        plot_stream();
+    }
+
+    // Write every seed, action and reward of the following runs into `log`
+    void set_replay_log(Replay_Writer* log) {
+        replay_log = log;
+    }
+
+    // Replay interface (see replay_log.h)
+    void replay_iteration(unsigned int seed, const std::vector<double>& Q) {
+        if (Target == TD_Target::Double_Q && Q.size() < 2 * NumNode * NumSlot) {
+            throw std::runtime_error("replay log has no Q_B matrices for Double Q");
+        }
+        set_seed(seed);
+        coin.seed(seed);
+        experience.seed(seed);
+        experience.clear();
+        for (auto& node : nodes) {
+            node.reset(true);
+            node.Q = q_row_from_double<Value>(Map<const RowVectorXd>(Q.data() + node.node_num * NumSlot, NumSlot));
+            if (Target == TD_Target::Double_Q) {
+                node.Q_B = q_row_from_double<Value>(Map<const RowVectorXd>(Q.data() + (NumNode + node.node_num) * NumSlot, NumSlot));
+            }
+        }
+    }
+    void replay_episode(unsigned int episode, const Replay_Action& action) {
+        episode_num = episode;
+        A_1() = action;
+    }
+    void replay_frame(const Replay_Action& action, const Replay_Reward& reward, const Replay_Mask& active) {
+        learn(action, reward, active);
+        A_1() = action;
+    }
+    void replay_episode_end(const Replay_Reward& reward) {
+        learn_final(reward);
+        cur_reward = 0;
+    }
+    RowVectorXd get_Q(int node_num) const {
+        return q_row_to_double<Value>(nodes[node_num].Q);
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // greedy slot of every node at the end of each iteration of the last train()
+    const std::vector<Replay_Action>& get_policies() const {
+        return policies;
+    }
+    // Replay `batch` past steps of a node after each of its updates, from a ring of td_replay_capacity
+    // steps per node. SARSA targets depend on the behaviour policy and are never replayed.
+    void enable_replay(int batch, Sampling sampling = Sampling::Uniform) {
+        replay_batch = batch;
+        experience.init(NumNode, td_replay_capacity, sampling);
+    }
+    // How nodes explore and how the strength decays over episodes, epsilon is the strength to start from
+    // Expected SARSA takes the expectation under epsilon-greedy, with other policies the greedy value
+    void set_exploration(Exploration policy, Schedule schedule = Schedule::Harmonic) {
+        exploration = policy;
+        explore = Exploration_Schedule(epsilon, schedule);
+        if (policy != Exploration::Epsilon_Greedy) {
+            plot_str += "[" + exploration_name(policy) + "]";
+        }
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    // Lower variance targets (Expected SARSA) need fewer iterations for the same confidence
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
     }
 
 
@@ -36,16 +148,24 @@ private:
     public:
         Node() = default;
         Node(const int& _node_num) : node_num(_node_num) {}
-        RowVectorXd Q = RowVectorXd::Random(NumSlot);
+        Q_Row<Value> Q = random_q_row<Value>(NumSlot);
+        Q_Row<Value> Q_B = Target == TD_Target::Double_Q ? random_q_row<Value>(NumSlot) : Q_Row<Value>();
         unsigned int node_num;
         unsigned int remaining_data = 0;
-        bool is_success;
+        bool is_success = false;
+        std::array<uint32_t, NumSlot> visits = { 0 };   // UCB only
+        uint32_t steps = 0;
 
         void reset(bool episode_end) {
-            remaining_data = 10;
+            remaining_data = data_target;
             is_success = false;
             if (episode_end) {
-                Q = RowVectorXd::Random(NumSlot);
+                visits.fill(0);
+                steps = 0;
+                Q = random_q_row<Value>(NumSlot);
+                if (Target == TD_Target::Double_Q) {
+                    Q_B = random_q_row<Value>(NumSlot);
+                }
             }
         }
     };
@@ -53,150 +173,370 @@ private:
     typedef std::array<int, NumNode> State;
     typedef std::array<int, NumNode> Action;
     typedef std::array<Node, NumNode> NodeArr;
+    typedef std::array<double, NumNode> Reward;
+    typedef std::array<bool, NumNode> Mask;
+
+    // a past step of one node, stateless so the slot and its reward are all there is
+    struct Step {
+        int slot;
+        Real reward;
+    };
     void init() {
         for (auto& node : nodes) {
-            A_1[node.node_num] = get_rand_int(0, NumSlot - 1);
+            A_1()[node.node_num] = get_rand_int(0, NumSlot - 1);
         }
     }
 
+    // at most `max_iterations`, and no more once `seconds` have passed if it is positive
+    void train_until(int max_iterations, double seconds) {
+        auto start = std::chrono::steady_clock::now();
+        std::ios::sync_with_stdio(false);
+        // restart the engine so every iteration begins from a known seed
+        set_seed(get_seed());
+        init();
+        policies.clear();
+        for (int i = 0; i < max_iterations; i++) {
+            coin.seed(get_seed());
+            experience.seed(get_seed());
+            experience.clear();
+            optimistic_start();
+            // after the optimistic raise, so replays start from the Q the iteration trains
+            log_iteration();
+            run_iteration();
+            policies.push_back(greedy_policy());
+            change_seed();
+            reset(true);
+            if (seconds > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= seconds) {
+                break;
+            }
+        }
+        iterations = static_cast<int>(policies.size());
+        calc_average();
+    }
+
     void run_iteration() {
         for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
-            A_1 = choose_action(A_1);
-#ifdef DEBUG
-            cout << "Episode #" << episode_num << ":" << endl;
-#endif 
-            int frame_num = 0;
-
-            // choose action and update Q matrix every step
-            for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
-                A_2 = choose_action(A_1);
-                update();
-                render(frame_num);
-            }
+            run_episode();
+        }
+    }
 
+    // A single episode: frame_num_target frames followed by the final reward
+    void run_episode() {
+        choose_action(A_1());
+        if (replay_log) replay_log->episode(episode_num, A_1());
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        int frame_num = 0;
 
-            // figure out if every node has successfully finished their transmissions
-            bool is_complete = true;
-            for (auto node : nodes) {
-                node.is_success ? ++success_node : is_complete = false;
-            }
-            data.success_data[episode_num] += success_data;
-            data.success_node[episode_num] += success_node;
-            
-            success_data = 0;
-            success_node = 0;
-            
-
-#ifdef DEBUG
-            cout << "Final policy matrix" << endl;
-            for (auto node : nodes) {
-                cout << std::setprecision(3) << std::fixed << node.Q << endl;
-            }
+        // choose action and update Q matrix every step
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            choose_action(A_2());
+            update();
+            render(frame_num);
+        }
 
-            if (!is_complete) {
-                cout << "Could not finish transmitting data in " << frame_num_target << " frames." << endl;
-                ++total_failure;
-            }
-            else {
-                cout << "Finished transmitting in " << frame_num << " frames." << endl;
-                ++total_success;
-            }
-            cout << "Total Success: " << total_success << endl;
-            cout << "Total Failure: " << total_failure << endl;
-#endif
-            final_reward();
-            data.cum_reward[episode_num] += cur_reward;
-            cur_reward = 0;
-            for (auto& node : nodes) {
-                node.reset(false);
-            }
+
+        // success_node counts nodes as they finish (see check_collision)
+        bool is_complete = success_node == NumNode;
+        is_complete ? ++total_success : ++total_failure;
+        trace_policy();
+        TRACE_COUNTER(1, "total_success", total_success);
+        TRACE_COUNTER(1, "total_failure", total_failure);
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+        
+
+        final_reward();
+        record_episode();
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+        for (auto& node : nodes) {
+            node.reset(false);
         }
     }
-    // Choose an action based on the given state
-    Action choose_action(const Action &action) {
-        Action temp_action;
+    // Choose the slot of every node into `temp_action`
+    void choose_action(Action& temp_action) {
+        PROFILE_SCOPE(Choose_Action);
         for (auto& node : nodes) {
             if (node.is_success) {
                 temp_action[node.node_num] = -1;
                 continue;
             }
-            if (epsilon / episode_num >= get_rand_real(0, 1)) {
-                //random action
-                auto random_num = get_rand_int(0, NumSlot - 1);
-                temp_action[node.node_num] = random_num;
+            switch (exploration) {
+            case Exploration::Softmax:
+                softmax.set(node.node_num, acting_row(node), get_rand_real(0, 1));
+                break;
+            case Exploration::UCB:
+                temp_action[node.node_num] = ucb_slot(node);
+                break;
+            case Exploration::Optimistic:
+                temp_action[node.node_num] = greedy_slot(node);
+                break;
+            default:
+                if (explore[episode_num] >= get_rand_real(0, 1)) {
+                    //random action
+                    auto random_num = get_rand_int(0, NumSlot - 1);
+                    temp_action[node.node_num] = random_num;
+                }
+                else {
+                    //optimal action
+                    temp_action[node.node_num] = greedy_slot(node);
+                }
             }
-            else {
-                //optimal action
-                int index;
-                node.Q.maxCoeff(&index);
-                temp_action[node.node_num] = index;
+        }
+        if (exploration == Exploration::Softmax) {
+            softmax.run(explore[episode_num]);
+            for (auto& node : nodes) {
+                if (!node.is_success) {
+                    temp_action[node.node_num] = softmax.slot(node.node_num);
+                }
             }
         }
-        return temp_action;
     }
 
-    // Update Q matrix based on TD algorithm
+    // Q row the node acts on, the sum of both matrices for Double Q
+    Matrix<Real, 1, NumSlot> acting_row(const Node& node) const {
+        Matrix<Real, 1, NumSlot> row = q_row_real<Value>(node.Q);
+        if (Target == TD_Target::Double_Q) {
+            row += q_row_real<Value>(node.Q_B);
+        }
+        return row;
+    }
+
+    // greedy on Q plus the scheduled weight of the UCB1 bonus, counts the chosen slot
+    int ucb_slot(Node& node) {
+        auto row = acting_row(node);
+        double c = explore[episode_num];
+        int best = 0;
+        double best_value = -std::numeric_limits<double>::infinity();
+        for (int s = 0; s < NumSlot; s++) {
+            double value = row(s) + c * ucb(node.steps, node.visits[s]);
+            if (value > best_value) {
+                best_value = value;
+                best = s;
+            }
+        }
+        ++node.visits[best];
+        ++node.steps;
+        return best;
+    }
+
+    // optimistic policies start every iteration from Q rows raised to the return of succeeding every frame
+    void optimistic_start() {
+        if (exploration != Exploration::Optimistic) return;
+        Real top = static_cast<Real>(positive_feedback / (1 - gamma));
+        for (auto& node : nodes) {
+            node.Q = q_row_real<Value>(node.Q).unaryExpr([top](Real val) { return Traits::from_real(val + top); });
+            if (Target == TD_Target::Double_Q) {
+                node.Q_B = q_row_real<Value>(node.Q_B).unaryExpr([top](Real val) { return Traits::from_real(val + top); });
+            }
+        }
+    }
+
+    // Get rewards of A_2 from the channel and update Q matrix
     void update() {
-        int reward;
+        Reward reward = { 0.0 };
+        Mask active = { false };
+        check_collision(A_2(), reward, active);
+        learn(A_2(), reward, active);
+        if (replay_log) replay_log->frame(A_2(), reward, active);
+        record_frame();
+        success_frame = 0;
+        current ^= 1;
+    }
+
+    // rewards of nodes that still have data to send
+    void check_collision(const Action& action, Reward& reward, Mask& active) {
+        PROFILE_SCOPE(Collision);
+        double idle = rewards.idle(action);
         for (auto& node : nodes) {
             if (node.remaining_data != 0) {
                 auto nn = node.node_num;
+                active[nn] = true;
                 // collision X
-                if (std::count(A_2.begin(), A_2.end(), A_2[nn]) == 1) {
-                    reward = positive_feedback;
+                bool success = std::count(action.begin(), action.end(), action[nn]) == 1;
+                if (success) {
                     node.remaining_data -= 1;
                     ++success_data;
                     ++success_frame;
                     if (node.remaining_data == 0) {
                         node.is_success = true;
+                        ++success_node;
                     }
                 }
-                // collision O
-                else {
-                    reward = negative_feedback;
+                reward[nn] = rewards.step(success, node.remaining_data) + idle;
+            }
+        }
+    }
+
+    // Update Q matrix based on TD algorithm
+    // Off-policy targets also store the step and replay a minibatch of the node's past steps
+    void learn(const Action& action, const Reward& reward, const Mask& active) {
+        PROFILE_SCOPE(Update);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (active[nn]) {
+                td_step(node, A_1()[nn], static_cast<Real>(reward[nn]), action[nn]);
+                if (replay_batch > 0 && Target != TD_Target::Sarsa) {
+                    experience.push(nn, { A_1()[nn], static_cast<Real>(reward[nn]) });
+                    replay_node(node);
                 }
-                double predict = node.Q(A_1[nn]);
-                double target = reward + gamma * node.Q(A_2[nn]);
-                node.Q(A_1[nn]) += alpha * (target - predict);
 
-                cur_reward += reward;
+                cur_reward += reward[nn];
             }
         }
-        data.success_frame[frame_num_data++] += success_frame;
-        success_frame = 0;
-        A_1 = A_2;
+    }
+
+    // One TD update of `slot` in the Q matrix of `node`, returns the TD error
+    // `next_slot` is the next action and only used by SARSA
+    // Double Q-learning: a coin picks which matrix is updated, the other one evaluates its greedy slot
+    Real td_step(Node& node, int slot, Real reward, int next_slot) {
+        if (Target == TD_Target::Double_Q) {
+            bool update_a = coin() & 1;
+            auto& Q_update = update_a ? node.Q : node.Q_B;
+            auto& Q_eval = update_a ? node.Q_B : node.Q;
+            int index;
+            Q_update.maxCoeff(&index);
+            Real predict = Traits::to_real(Q_update(slot));
+            Real target = reward + gamma * Traits::to_real(Q_eval(index));
+            Q_update(slot) = Traits::from_real(predict + alpha * (target - predict));
+            return target - predict;
+        }
+        Real next;
+        if (Target == TD_Target::Sarsa) {
+            next = Traits::to_real(node.Q(next_slot));
+        }
+        else {
+            Real explore = Target == TD_Target::Expected_Sarsa ? explore_prob() : Real(0);
+            auto Q = q_row_real<Value>(node.Q);
+            next = (1 - explore) * Q.maxCoeff() + explore * Q.mean();
+        }
+        Real predict = Traits::to_real(node.Q(slot));
+        Real target = reward + gamma * next;
+        node.Q(slot) = Traits::from_real(predict + alpha * (target - predict));
+        return target - predict;
+    }
+
+    // re-apply replay_batch stored steps of `node`, prioritized sampling steps are scaled by their weight
+    void replay_node(Node& node) {
+        const auto& batch = experience.sample(node.node_num, replay_batch);
+        for (auto& s : batch) {
+            const auto& step = experience[s.id];
+            Real saved = alpha;
+            alpha *= static_cast<Real>(s.weight);
+            Real error = td_step(node, step.slot, step.reward, step.slot);
+            alpha = saved;
+            experience.update_priority(s.id, error);
+        }
+    }
 
+    // probability of a random action in this episode
+    Real explore_prob() const {
+        if (exploration != Exploration::Epsilon_Greedy) return Real(0);
+        return std::min(Real(1), static_cast<Real>(explore[episode_num]));
+    }
+
+    // Double Q acts on the sum of both matrices
+    int greedy_slot(const Node& node) const {
+        int index;
+        if (Target == TD_Target::Double_Q) {
+            (q_row_real<Value>(node.Q) + q_row_real<Value>(node.Q_B)).maxCoeff(&index);
+        }
+        else {
+            node.Q.maxCoeff(&index);
+        }
+        return index;
     }
 
     // distribute reward at the end of an episode based on 
     // whether a node has finised transmission or not
     void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        Reward reward;
+        double bonus = rewards.episode_bonus(nodes);
         for (auto& node : nodes) {
-            int index = 0;
-            node.Q.maxCoeff(&index);
-            if (node.is_success) {
-                node.Q[index] += episode_success;
-                cur_reward += episode_success;
-            }
-            else {
-                node.Q[index] += episode_failure;
-                cur_reward += episode_failure;
+            reward[node.node_num] = rewards.final(node.is_success, bonus);
+        }
+        learn_final(reward);
+        if (replay_log) replay_log->episode_end(reward);
+    }
+
+    // the terminal reward goes to the greedy slot, for Double Q into one matrix picked by a coin as in td_step
+    void learn_final(const Reward& reward) {
+        for (auto& node : nodes) {
+            int index = greedy_slot(node);
+            auto& Q = Target == TD_Target::Double_Q && !(coin() & 1) ? node.Q_B : node.Q;
+            Q[index] = Traits::from_real(Traits::to_real(Q[index]) + static_cast<Real>(reward[node.node_num]));
+            cur_reward += reward[node.node_num];
+        }
+    }
+
+    // Double Q logs Q_B after Q, so a replay starts from both matrices
+    void log_iteration() {
+        if (!replay_log) return;
+        int matrices = Target == TD_Target::Double_Q ? 2 : 1;
+        std::vector<double> Q(matrices * NumNode * NumSlot);
+        for (auto& node : nodes) {
+            Map<RowVectorXd>(Q.data() + node.node_num * NumSlot, NumSlot) = q_row_to_double<Value>(node.Q);
+            if (Target == TD_Target::Double_Q) {
+                Map<RowVectorXd>(Q.data() + (NumNode + node.node_num) * NumSlot, NumSlot) = q_row_to_double<Value>(node.Q_B);
             }
         }
+        replay_log->iteration(get_seed(), Q);
     }
 
 
-    // rendering which node decided to transmit on which slot
+    Action greedy_policy() const {
+        Action policy;
+        for (auto& node : nodes) {
+            policy[node.node_num] = greedy_slot(node);
+        }
+        return policy;
+    }
+
+    // trace which node decided to transmit on which slot
     void render(int step) {
-#ifdef DEBUG
-        printf("Step #%d ", step);
-        for (auto i : A_1) {
-            printf("%2d ", i);
+        TRACE_INSTANT(2, "frame", "step", step);
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "action", "node", node.node_num, "slot", A_1()[node.node_num]);
+        }
+#endif
+    }
+
+    // trace the greedy slot of every node
+    void trace_policy() {
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "policy", "node", node.node_num, "slot", greedy_slot(node));
         }
-        printf("\n");
 #endif
     }
 
+    // per-step and per-episode results go to Plot_Data, or to Stream_Data in long-horizon mode
+    void record_frame() {
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        if (streaming) {
+            stream.success_frame.push(success_frame);
+        }
+        else {
+            data.success_frame[frame_num_data++] += success_frame;
+        }
+    }
+
+    void record_episode() {
+        if (streaming) {
+            stream.success_data.push(success_data);
+            stream.success_node.push(success_node);
+            stream.cum_reward.push(cur_reward);
+            ++stream.episodes;
+        }
+        else {
+            data.success_data[episode_num] += success_data;
+            data.success_node[episode_num] += success_node;
+            data.cum_reward[episode_num] += cur_reward;
+        }
+    }
+
     void plot() {
         //plt::subplot(1, 3, 1);
         //plt::title("Success Frame");
@@ -217,11 +557,24 @@ private:
         plt::legend();
     }
 
+    void plot_stream() {
+        std::vector<double> x, y;
+        stream.cum_reward.trace.get(x, y);
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, x, y);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+        cout << plot_str << " rolling mean of last " << stream_window << " episodes: "
+             << std::setprecision(3) << std::fixed << stream.cum_reward.rolling.mean() << endl;
+    }
+
     void calc_average() {
-        std::for_each(data.success_frame.begin(), data.success_frame.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.success_data.begin(), data.success_data.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.success_node.begin(), data.success_node.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [](double& val) {val = val / iterations_target; });
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
 
     }
 
@@ -236,16 +589,33 @@ private:
     std::string plot_str;
 
     NodeArr nodes;
-    Action A_1, A_2;
+    // actions of the current and the next frame, a frame ends by flipping `current` instead of copying
+    std::array<Action, 2> actions;
+    int current = 0;
+    Action& A_1() { return actions[current]; }
+    Action& A_2() { return actions[current ^ 1]; }
     Plot_Data data;
+    Reward_Table rewards;
+    Stream_Data stream;
+    bool streaming = false;
+    Replay_Writer* replay_log = nullptr;
+    std::vector<Action> policies;
+    std::minstd_rand coin;      // Double Q table choice, reseeded with every iteration so replays match
+    Replay_Buffer<Step> experience;
+    int replay_batch = 0;
+    int iterations = iterations_target;
 
     int success_frame = 0;
     int success_data = 0;
     int success_node = 0;
 
-    double gamma = 0.6;
-    double alpha = 0.1;
+    Real gamma = Real(0.6);
+    Real alpha = Real(0.1);
     double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // exploration strength per episode
+    Exploration exploration = Exploration::Epsilon_Greedy;
+    Ucb_Bonus ucb;
+    Softmax_Batch<NumNode> softmax;
 
 
     unsigned int total_success = 0;
@@ -0,0 +1 @@
+#include "bandit.h"
@@ -0,0 +1,298 @@
+#pragma once
+#include "include.h"
+
+enum class Bandit { UCB1, Thompson };
+
+// Bandit learners: every node picks its slot as a multi-armed bandit over NumSlot slots
+// The slot choice does not depend on any state, a node only learns which slot others leave free,
+// so the success and failure counters of its slots are all it keeps. They are one float block
+// with the success counters of all nodes in the top NumNode rows and the failures below, column
+// major, so every frame scores all nodes and slots with array expressions:
+//   UCB1      successes / n + c * sqrt(ln t / n), untried slots first
+//   Thompson  a Beta(successes + 1, failures + 1) draw per slot, from two gamma draws
+// Identical nodes with a deterministic UCB1 would all pick the same slot forever, so scores get a
+// jitter far below any count difference and ties are broken at random.
+// Counters start over every iteration and carry over between episodes, as Q does in the other learners.
+class SlottedAlohaRL_Bandit {
+public:
+    SlottedAlohaRL_Bandit(Bandit policy = Bandit::Thompson, const double& c = 0.25) :
+        policy(policy), c(static_cast<float>(c))
+    {
+        if (policy == Bandit::UCB1) {
+            std::stringstream stream;
+            stream << std::fixed << std::setprecision(2) << c;
+            plot_str = "UCB1(c=" + stream.str() + ")";
+        }
+        else {
+            plot_str = "Thompson";
+        }
+        int i = 0;
+        for (auto& node : nodes) {
+            node.node_num = i++;
+        }
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    void train() {
+        std::ios::sync_with_stdio(false);
+        set_seed(get_seed());
+        for (int i = 0; i < iterations; i++) {
+            lanes.seed();
+            run_iteration();
+            change_seed();
+            reset(true);
+        }
+        calc_average();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+
+private:
+    struct Node {
+        friend class SlottedAlohaRL_Bandit;
+    public:
+        unsigned int node_num;
+        unsigned int remaining_data = data_target;
+        bool is_success = false;
+
+        void reset() {
+            remaining_data = data_target;
+            is_success = false;
+        }
+    };
+
+    typedef std::array<int, NumNode> Action;
+    typedef std::array<Node, NumNode> NodeArr;
+    typedef std::array<double, NumNode> Reward;
+    typedef std::array<bool, NumNode> Mask;
+    typedef Array<float, 2 * NumNode, NumSlot> Counts;     // successes over failures
+    typedef Array<float, NumNode, NumSlot> Scores;
+    typedef Array<float, NumNode, 1> Column;
+
+    void run_iteration() {
+        for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
+            run_episode();
+        }
+    }
+
+    void run_episode() {
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            Reward reward = { 0.0 };
+            Mask active = { false };
+            choose_action();
+            check_collision(action, reward, active);
+            render(frame_num);
+        }
+
+        bool is_complete = true;
+        for (auto& node : nodes) {
+            node.is_success ? ++success_node : is_complete = false;
+        }
+        is_complete ? ++total_success : ++total_failure;
+        TRACE_COUNTER(1, "total_success", total_success);
+        TRACE_COUNTER(1, "total_failure", total_failure);
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+
+        final_reward();
+        data.success_data[episode_num] += success_data;
+        data.success_node[episode_num] += success_node;
+        data.cum_reward[episode_num] += cur_reward;
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+        for (auto& node : nodes) {
+            node.reset();
+        }
+    }
+
+    // the highest scoring slot of every node, nodes without data stay silent
+    void choose_action() {
+        PROFILE_SCOPE(Choose_Action);
+        if (policy == Bandit::UCB1) {
+            score_ucb();
+        }
+        else {
+            score_thompson();
+        }
+        Column best = scores.col(0);
+        Array<int, NumNode, 1> slot = Array<int, NumNode, 1>::Zero();
+        for (int s = 1; s < NumSlot; s++) {
+            Array<bool, NumNode, 1> better = scores.col(s) > best;
+            best = better.select(scores.col(s), best);
+            slot = better.select(Array<int, NumNode, 1>::Constant(s), slot);
+        }
+        for (auto& node : nodes) {
+            action[node.node_num] = node.is_success ? -1 : slot(node.node_num);
+        }
+    }
+
+    void score_ucb() {
+        Scores n = counts.topRows<NumNode>() + counts.bottomRows<NumNode>();
+        Column t = n.rowwise().sum().max(1.0f);
+        Scores inv_root = n.max(1.0f).rsqrt();
+        Scores tried = counts.topRows<NumNode>() * inv_root.square()
+                       + (c * t.log().sqrt()).replicate<1, NumSlot>() * inv_root;
+        // untried slots score above every bonus, in a random order
+        lanes.fill(draws.data());
+        auto u = draws.topRows<NumNode>();
+        scores = (n == 0.0f).select(1e3f * (1.0f + u), tried + 1e-6f * u);
+    }
+
+    // Beta(a, b) = X / (X + Y) with X ~ Gamma(a) and Y ~ Gamma(b), all shapes are at least 1
+    void score_thompson() {
+        Counts gamma = sample_gamma(counts + 1.0f);
+        scores = gamma.topRows<NumNode>() / (gamma.topRows<NumNode>() + gamma.bottomRows<NumNode>());
+    }
+
+    // Marsaglia-Tsang for shapes a >= 1: d * v with v = (1 + x / sqrt(9d))^3, d = a - 1/3 and x
+    // normal, accepted if u < 1 - 0.0331 x^4 or else if ln u < x^2 / 2 + d - d v + d ln v.
+    // One round draws for every lane at once and the first test, which needs no logarithm, accepts
+    // about 92% of them. The others take the full test and draw again one at a time.
+    Counts sample_gamma(const Counts& a) {
+        Counts d = a - 1.0f / 3.0f;
+        Counts k = (9.0f * d).rsqrt();
+        // Box-Muller, the cosine feeds the success rows and the sine the failure rows
+        Counts x;
+        lanes.fill(draws.data());
+        Scores radius = (-2.0f * fast_log<NumNode, NumSlot>(draws.topRows<NumNode>())).sqrt();
+        Scores cos = (6.28318531f * draws.bottomRows<NumNode>()).cos();
+        // the sine from the cosine, negative for angles past pi
+        Scores sin = (1.0f - cos.square()).max(0.0f).sqrt();
+        x.topRows<NumNode>() = radius * cos;
+        x.bottomRows<NumNode>() = (draws.bottomRows<NumNode>() < 0.5f).select(radius * sin, -radius * sin);
+
+        Counts y = 1.0f + k * x;
+        Counts out = d * y.cube();
+        lanes.fill(draws.data());
+        Array<bool, 2 * NumNode, NumSlot> accept = (y > 0.0f) && (draws < 1.0f - 0.0331f * x.square().square());
+        if (accept.all()) return out;
+        for (int i = 0; i < out.size(); i++) {
+            if (!accept(i)) out(i) = gamma_retry(d(i), k(i), x(i), draws(i));
+        }
+        return out;
+    }
+
+    // the full test of a lane the first test rejected, then fresh draws until one is accepted
+    static float gamma_retry(double d, double k, double x, double u) {
+        while (true) {
+            double y = 1.0 + k * x;
+            if (y > 0.0) {
+                double v = y * y * y;
+                if (std::log(u) < 0.5 * x * x + d - d * v + d * std::log(v)) {
+                    return static_cast<float>(d * v);
+                }
+            }
+            x = std::sqrt(-2.0 * std::log(1.0 - get_rand_real(0, 1))) * std::cos(6.283185307179586 * get_rand_real(0, 1));
+            u = get_rand_real(0, 1);
+        }
+    }
+
+    // Every node that still has data learns whether its slot was free
+    void check_collision(const Action& action, Reward& reward, Mask& active) {
+        PROFILE_SCOPE(Collision);
+        double idle = rewards.idle(action);
+        for (auto& node : nodes) {
+            if (node.remaining_data != 0) {
+                auto nn = node.node_num;
+                active[nn] = true;
+                bool success = std::count(action.begin(), action.end(), action[nn]) == 1;
+                if (success) {
+                    --node.remaining_data;
+                    ++success_data;
+                    ++success_frame;
+                    if (node.remaining_data == 0) {
+                        node.is_success = true;
+                    }
+                }
+                counts(success ? nn : NumNode + nn, action[nn]) += 1.0f;
+                reward[nn] = rewards.step(success, node.remaining_data) + idle;
+                cur_reward += reward[nn];
+            }
+        }
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[frame_num_data++] += success_frame;
+        success_frame = 0;
+    }
+
+    // episode rewards only count towards the results, the counters learn from slot outcomes
+    void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        double bonus = rewards.episode_bonus(nodes);
+        for (auto& node : nodes) {
+            cur_reward += rewards.final(node.is_success, bonus);
+        }
+    }
+
+    void render(int step) {
+        TRACE_INSTANT(2, "frame", "step", step);
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "action", "node", node.node_num, "slot", action[node.node_num]);
+        }
+#endif
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
+    }
+
+    void reset(bool iteration_end) {
+        for (auto& node : nodes) {
+            node.reset();
+        }
+        if (iteration_end) {
+            counts.setZero();
+        }
+        frame_num_data = 0;
+        cur_reward = 0;
+    }
+
+    std::string plot_str;
+
+    NodeArr nodes;
+    Action action;
+    Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+
+    Bandit policy = Bandit::Thompson;
+    float c = 0.25f;                            // UCB1 bonus weight
+
+    Counts counts = Counts::Zero();
+    Scores scores;
+    Counts draws;                               // uniforms of the last fill
+    Uniform_Lanes<2 * NumNode * NumSlot> lanes;
+
+    int success_frame = 0;
+    int success_data = 0;
+    int success_node = 0;
+
+    unsigned int total_success = 0;
+    unsigned int total_failure = 0;
+    unsigned int frame_num = 0;
+    unsigned int frame_num_data = 0;
+    unsigned int episode_num = 0;
+
+    double cur_reward = 0;
+};
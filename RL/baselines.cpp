@@ -0,0 +1 @@
+#include "baselines.h"
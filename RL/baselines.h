@@ -0,0 +1,268 @@
+#pragma once
+#include "include.h"
+#include "scheduler.h"
+
+// Reference policies and models to judge learners against
+//   ALOHA   every node with data sends in a frame with the transmit probability that maximises the
+//           expected successes for the current backlog, on a uniform random slot
+//   TDMA    an oracle that knows every backlog and gives each node with data a slot of its own,
+//           round robin when there are more nodes than slots. No policy delivers more.
+// Both also have closed forms for an episode, which the throughput report divides results by.
+
+namespace baseline {
+
+// expected successes of a frame of `slots` slots in which each of `nodes` nodes sends with
+// probability q on a uniform slot
+inline double aloha_frame(int nodes, int slots, double q) {
+    return nodes > 0 ? nodes * q * std::pow(1.0 - q / slots, nodes - 1) : 0.0;
+}
+
+// q that maximises aloha_frame, every node sends while there are no more nodes than slots
+inline double aloha_q(int nodes, int slots) {
+    return nodes <= slots ? 1.0 : static_cast<double>(slots) / nodes;
+}
+
+// expected data of an episode under ALOHA at the optimal q
+// Mean field: every node delivers the expected share of a frame, so all nodes run out together.
+inline double aloha_episode(int nodes = NumNode, int slots = NumSlot, int frames = frame_num_target, int data = data_target) {
+    double remaining = data;
+    double total = 0.0;
+    for (int f = 0; f < frames && remaining > 0.0; f++) {
+        double share = aloha_frame(nodes, slots, aloha_q(nodes, slots)) / nodes;
+        double sent = std::min(share, remaining);
+        remaining -= sent;
+        total += nodes * sent;
+    }
+    return total;
+}
+
+// data of an episode under the TDMA oracle, the most any policy can deliver
+inline double tdma_episode(int nodes = NumNode, int slots = NumSlot, int frames = frame_num_target, int data = data_target) {
+    std::vector<int> remaining(nodes, data);
+    int next = 0;
+    double total = 0.0;
+    for (int f = 0; f < frames; f++) {
+        int backlog = static_cast<int>(std::count_if(remaining.begin(), remaining.end(), [](int r) { return r > 0; }));
+        for (int s = 0; s < std::min(backlog, slots); s++) {
+            while (remaining[next] == 0) next = (next + 1) % nodes;
+            --remaining[next];
+            next = (next + 1) % nodes;
+            ++total;
+        }
+    }
+    return total;
+}
+
+}   // namespace baseline
+
+enum class Baseline { ALOHA, TDMA };
+
+// The reference policies as a learner, so they run in sweeps and configs, share the episode,
+// reward and result code of the learners and plot next to them. Neither of them learns.
+class SlottedAlohaRL_Baseline {
+public:
+    SlottedAlohaRL_Baseline(Baseline policy = Baseline::TDMA) : policy(policy) {
+        plot_str = policy == Baseline::ALOHA ? "ALOHA(optimal q)" : "TDMA oracle";
+        int i = 0;
+        for (auto& node : nodes) {
+            node.node_num = i++;
+        }
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    void train() {
+        set_seed(get_seed());
+        for (int i = 0; i < iterations; i++) {
+            run_iteration();
+            change_seed();
+            frame_num_data = 0;
+        }
+        calc_average();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+
+private:
+    struct Node {
+        unsigned int node_num;
+        unsigned int remaining_data = data_target;
+        bool is_success = false;
+
+        void reset() {
+            remaining_data = data_target;
+            is_success = false;
+        }
+    };
+
+    typedef std::array<int, NumNode> Action;
+    typedef std::array<Node, NumNode> NodeArr;
+
+    void run_iteration() {
+        for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
+            run_episode();
+        }
+    }
+
+    void run_episode() {
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        next = 0;
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            policy == Baseline::ALOHA ? choose_aloha() : choose_tdma();
+            check_collision();
+        }
+
+        bool is_complete = true;
+        for (auto& node : nodes) {
+            node.is_success ? ++success_node : is_complete = false;
+        }
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+
+        double bonus = rewards.episode_bonus(nodes);
+        for (auto& node : nodes) {
+            cur_reward += rewards.final(node.is_success, bonus);
+        }
+        data.success_data[episode_num] += success_data;
+        data.success_node[episode_num] += success_node;
+        data.cum_reward[episode_num] += cur_reward;
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+        for (auto& node : nodes) {
+            node.reset();
+        }
+    }
+
+    int backlog() const {
+        int count = 0;
+        for (auto& node : nodes) {
+            if (node.remaining_data != 0) ++count;
+        }
+        return count;
+    }
+
+    void choose_aloha() {
+        PROFILE_SCOPE(Choose_Action);
+        double q = baseline::aloha_q(backlog(), NumSlot);
+        for (auto& node : nodes) {
+            bool send = node.remaining_data != 0 && (q >= 1.0 || get_rand_real(0, 1) < q);
+            action[node.node_num] = send ? get_rand_int(0, NumSlot - 1) : -1;
+        }
+    }
+
+    // slots in node order from where the last frame stopped
+    void choose_tdma() {
+        PROFILE_SCOPE(Choose_Action);
+        action.fill(-1);
+        int slots = std::min(backlog(), NumSlot);
+        for (int s = 0; s < slots; s++) {
+            while (nodes[next].remaining_data == 0) next = (next + 1) % NumNode;
+            action[next] = s;
+            next = (next + 1) % NumNode;
+        }
+    }
+
+    void check_collision() {
+        PROFILE_SCOPE(Collision);
+        std::array<int, NumSlot> occupancy = { 0 };
+        for (auto slot : action) {
+            if (slot >= 0) ++occupancy[slot];
+        }
+        double idle = rewards.idle(action);
+        for (auto& node : nodes) {
+            int slot = action[node.node_num];
+            if (node.remaining_data == 0) continue;
+            if (slot < 0) {
+                cur_reward += idle;
+                continue;
+            }
+            bool success = occupancy[slot] == 1;
+            if (success) {
+                --node.remaining_data;
+                ++success_data;
+                ++success_frame;
+                if (node.remaining_data == 0) {
+                    node.is_success = true;
+                }
+            }
+            cur_reward += rewards.step(success, node.remaining_data) + idle;
+        }
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[frame_num_data++] += success_frame;
+        success_frame = 0;
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
+    }
+
+    std::string plot_str;
+
+    NodeArr nodes;
+    Action action;
+    Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+    Baseline policy = Baseline::TDMA;
+    int next = 0;                               // TDMA: node the next slot goes to
+
+    int success_frame = 0;
+    int success_data = 0;
+    int success_node = 0;
+
+    unsigned int frame_num = 0;
+    unsigned int frame_num_data = 0;
+    unsigned int episode_num = 0;
+
+    double cur_reward = 0;
+};
+
+// Data per episode of every job over the last third of the episodes, as a fraction of the TDMA
+// oracle and of optimal ALOHA at the job's own node and slot counts (Sweep::set_sizes)
+// Jobs without a fixed population have no reference and only print their data.
+inline void throughput_report(const Sweep& sweep) {
+    const int window = std::max(1, episode_num_target / 3);
+    bool unmatched = false;
+    cout << "Throughput over the last " << window << " episodes, per episode: TDMA oracle "
+         << std::fixed << std::setprecision(1) << baseline::tdma_episode() << ", optimal ALOHA " << baseline::aloha_episode()
+         << " at " << NumNode << " nodes and " << NumSlot << " slots\n"
+         << std::left << std::setw(36) << "label" << std::right
+         << std::setw(10) << "data" << std::setw(12) << "of oracle" << std::setw(12) << "of ALOHA" << "\n";
+    for (int j = 0; j < sweep.size(); j++) {
+        auto& result = sweep.result(j).success_data;
+        double mean = std::accumulate(result.end() - window, result.end(), 0.0) / window;
+        cout << std::left << std::setw(36) << sweep.label(j) << std::right
+             << std::setw(10) << std::setprecision(1) << mean;
+        if (sweep.nodes(j) <= 0) {
+            unmatched = true;
+            cout << std::setw(12) << "-" << std::setw(12) << "-" << "\n";
+            continue;
+        }
+        double oracle = baseline::tdma_episode(sweep.nodes(j), sweep.slots(j));
+        double aloha = baseline::aloha_episode(sweep.nodes(j), sweep.slots(j));
+        cout << std::setw(11) << std::setprecision(1) << 100.0 * mean / oracle << "%"
+             << std::setw(11) << std::setprecision(0) << 100.0 * mean / aloha << "%" << "\n";
+    }
+    if (unmatched) {
+        cout << "- node churn has no fixed population to compare against\n";
+    }
+    cout.flush();
+}
@@ -0,0 +1,3 @@
+#include "batch.h"
+
+template class SlottedAlohaRL_Batch<>;
@@ -0,0 +1,226 @@
+#pragma once
+#include "include.h"
+
+// TD (SARSA) over `Batch` independent networks in lockstep
+// Every network is one iteration of the other learners, so train() runs its iterations Batch at a
+// time and averages them the same way. State is kept with the network as the innermost dimension:
+//   Q         [Batch x NumNode * NumSlot], column n * NumSlot + s is Q(n, s) of every network
+//   actions   [Batch x NumNode], a slot, or -1 - n for a node that is silent
+//   remaining [Batch x NumNode]
+// so action choice, collision count and rewards are loops over nodes and slots whose every step is
+// an Eigen array operation over all networks, filling SIMD lanes even with 10 nodes. A silent node
+// gets an action of its own below 0 and never matches anybody in the collision count.
+// Of the reward shaping (see reward.h) only the collision and delay terms apply, as in the
+// multi-threaded learner.
+template <int Batch = batch_networks>
+class SlottedAlohaRL_Batch {
+public:
+    SlottedAlohaRL_Batch(const double& epsilon = 0.1, const double& alpha = 0.1, const double& gamma = 0.6) :
+        epsilon(epsilon), alpha(static_cast<float>(alpha)), gamma(static_cast<float>(gamma))
+    {
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(2) << epsilon;
+        plot_str = "Batch TD(B=" + std::to_string(Batch) + ", e=" + stream.str() + ")";
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    // iterations in groups of Batch networks, the last group records only the networks it needs
+    void train() {
+        set_seed(get_seed());
+        for (int done = 0; done < iterations; done += Batch) {
+            live = std::min(Batch, iterations - done);
+            lanes.seed();
+            reset_Q();
+            run_iteration();
+            change_seed();
+            frame_num_data = 0;
+        }
+        calc_average();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+
+private:
+    typedef Array<float, Batch, 1> Lane;
+    typedef Array<int, Batch, 1> Int_Lane;
+    typedef Array<float, Batch, NumNode * NumSlot> Q_Tensor;
+    typedef Array<int, Batch, NumNode> Action;
+    typedef Array<float, Batch, NumNode> Reward;
+
+    void run_iteration() {
+        for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
+            run_episode();
+        }
+    }
+
+    void run_episode() {
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        remaining = Action::Constant(data_target);
+        choose_action(A_1());
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            check_collision();
+            choose_action(A_2());
+            update();
+            current ^= 1;
+        }
+        final_reward();
+
+        auto done = (remaining == 0).template cast<int>().topRows(live);
+        int success_node = done.sum();
+#if TRACE_LEVEL >= 1
+        int complete = (done.rowwise().sum() == NumNode).count();
+        TRACE_END(1, "episode", "success_node", success_node, "complete", complete);
+#endif
+        data.success_data[episode_num] += success_data;
+        data.success_node[episode_num] += success_node;
+        data.cum_reward[episode_num] += cur_reward;
+        success_data = 0;
+        cur_reward = 0;
+    }
+
+    // highest Q slot of node `n` in every network
+    Int_Lane greedy(int n) const {
+        Lane best = Q.col(n * NumSlot);
+        Int_Lane slot = Int_Lane::Zero();
+        for (int s = 1; s < NumSlot; s++) {
+            Array<bool, Batch, 1> better = Q.col(n * NumSlot + s) > best;
+            best = better.select(Q.col(n * NumSlot + s), best);
+            slot = better.select(Int_Lane::Constant(s), slot);
+        }
+        return slot;
+    }
+
+    void choose_action(Action& action) {
+        PROFILE_SCOPE(Choose_Action);
+        float eps = static_cast<float>(explore[episode_num]);
+        lanes.fill(u_explore.data());
+        lanes.fill(u_slot.data());
+        for (int n = 0; n < NumNode; n++) {
+            Int_Lane random = (u_slot.col(n) * NumSlot).template cast<int>().min(NumSlot - 1);
+            Int_Lane chosen = (u_explore.col(n) <= eps).select(random, greedy(n));
+            action.col(n) = (remaining.col(n) > 0).select(chosen, Int_Lane::Constant(-1 - n));
+        }
+    }
+
+    // a node succeeds if no other node of its network picked its slot
+    void check_collision() {
+        PROFILE_SCOPE(Collision);
+        Action same = Action::Zero();
+        for (int n = 0; n < NumNode; n++) {
+            for (int m = 0; m < NumNode; m++) {
+                same.col(n) += (A_1().col(m) == A_1().col(n)).template cast<int>();
+            }
+        }
+        sent = A_1() >= 0;
+        Array<bool, Batch, NumNode> success = sent && (same == 1);
+        remaining -= success.template cast<int>();
+        float base_success = static_cast<float>(rewards.step_base(true));
+        float base_failure = static_cast<float>(rewards.step_base(false));
+        float delay = static_cast<float>(rewards.delay_per_data());
+        reward = sent.select(success.select(Reward::Constant(base_success), base_failure)
+                             - delay * remaining.template cast<float>(), 0.0f);
+
+        int success_frame = success.template cast<int>().topRows(live).sum();
+        success_data += success_frame;
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[frame_num_data++] += success_frame;
+    }
+
+    // SARSA on A_1 -> A_2
+    // Slots differ between networks, so Q values are gathered and scattered one network at a time
+    // and only the TD error in between is an array operation.
+    void update() {
+        PROFILE_SCOPE(Update);
+        for (int n = 0; n < NumNode; n++) {
+            Lane q1, q2;
+            for (int b = 0; b < Batch; b++) {
+                q1(b) = A_1()(b, n) >= 0 ? Q(b, n * NumSlot + A_1()(b, n)) : 0.0f;
+                q2(b) = A_2()(b, n) >= 0 ? Q(b, n * NumSlot + A_2()(b, n)) : 0.0f;
+            }
+            Lane delta = alpha * (reward.col(n) + gamma * q2 - q1);
+            for (int b = 0; b < Batch; b++) {
+                if (A_1()(b, n) >= 0) Q(b, n * NumSlot + A_1()(b, n)) += delta(b);
+            }
+        }
+        cur_reward += reward.topRows(live).template cast<double>().sum();
+    }
+
+    // terminal reward at the greedy slot of every node
+    void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        float success = static_cast<float>(rewards.final(true));
+        float failure = static_cast<float>(rewards.final(false));
+        for (int n = 0; n < NumNode; n++) {
+            Int_Lane best = greedy(n);
+            Lane terminal = (remaining.col(n) == 0).select(Lane::Constant(success), failure);
+            for (int s = 0; s < NumSlot; s++) {
+                Q.col(n * NumSlot + s) += (best == s).select(terminal, 0.0f);
+            }
+            cur_reward += terminal.topRows(live).template cast<double>().sum();
+        }
+    }
+
+    // uniform in [-1, 1] as the other learners start their Q rows
+    void reset_Q() {
+        for (int s = 0; s < NumSlot; s++) {
+            lanes.fill(Q.data() + s * Batch * NumNode);
+        }
+        Q = 2.0f * Q - 1.0f;
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
+    }
+
+    std::string plot_str;
+
+    Q_Tensor Q;
+    // actions of the current and the next frame, a frame ends by flipping `current` instead of copying
+    std::array<Action, 2> actions;
+    int current = 0;
+    Action& A_1() { return actions[current]; }
+    Action& A_2() { return actions[current ^ 1]; }
+    Action remaining;
+    Array<bool, Batch, NumNode> sent;
+    Reward reward;
+    Reward u_explore, u_slot;                   // uniforms of the last choice
+    Uniform_Lanes<Batch * NumNode> lanes;
+
+    Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+    int live = Batch;                           // networks of the group that are recorded
+
+    double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
+    float alpha = 0.1f;
+    float gamma = 0.6f;
+
+    int success_data = 0;
+
+    unsigned int frame_num = 0;
+    unsigned int frame_num_data = 0;
+    unsigned int episode_num = 0;
+
+    double cur_reward = 0;
+};
@@ -0,0 +1,227 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "global.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// On-disk cache of sweep results
+// Every result is stored under the hash of its key: the learner and its parameters, the number of
+// iterations, the sizes of global.h, the reward constants, the seed scheme and result_cache_version.
+// A lookup maps the file into memory and copies its series into a Plot_Data, so re-plotting a sweep,
+// or running one that shares jobs with an earlier sweep, only trains the jobs that are new.
+// Seeds are drawn from std::random_device, so a cached result is one sample of its job, the one
+// stored first. Bump result_cache_version whenever a change to a learner changes its results.
+//
+// File: magic, format, key length, the lengths of the four Plot_Data series, the key itself, then
+// the series as doubles. The key is compared on every load, so a hash collision is a miss.
+
+namespace result_cache {
+
+constexpr uint32_t file_magic = 0x43524C50;     // "PLRC"
+constexpr uint32_t file_format = 1;
+constexpr char seed_scheme[] = "random_device";
+
+// Plot_Data series in file order
+inline std::vector<double>* series(Plot_Data& data, int i) {
+    std::vector<double>* all[] = { &data.success_frame, &data.success_data, &data.success_node, &data.cum_reward };
+    return all[i];
+}
+
+// 64-bit FNV-1a
+inline uint64_t hash(const std::string& text) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        h = (h ^ c) * 1099511628211ull;
+    }
+    return h;
+}
+
+// Read-only view of a whole file, empty if it does not exist or cannot be mapped
+class Mapped_File {
+public:
+    explicit Mapped_File(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                if (view) length = static_cast<size_t>(size.QuadPart);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* map = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                view = static_cast<const char*>(map);
+                length = static_cast<size_t>(info.st_size);
+            }
+        }
+        ::close(fd);
+#endif
+    }
+    ~Mapped_File() {
+        if (!view) return;
+#ifdef _WIN32
+        UnmapViewOfFile(view);
+#else
+        ::munmap(const_cast<char*>(view), length);
+#endif
+    }
+    Mapped_File(const Mapped_File&) = delete;
+    Mapped_File& operator=(const Mapped_File&) = delete;
+
+    const char* data() const {
+        return view;
+    }
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const char* view = nullptr;
+    size_t length = 0;
+};
+
+inline void make_dir(const std::string& dir) {
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    ::mkdir(dir.c_str(), 0755);
+#endif
+}
+
+}   // namespace result_cache
+
+// Full cache key of `iterations` iterations of the learner described by `learner`
+// `learner` has to name the learner type and every parameter that is not a default.
+inline std::string result_key(const std::string& learner, int iterations) {
+    const Reward_Constants& r = reward_constants();
+    std::stringstream key;
+    key << std::setprecision(17)
+        << "version " << result_cache_version << "\n"
+        << "learner " << learner << "\n"
+        << "iterations " << iterations << "\n"
+        << "sizes " << NumNode << " " << NumSlot << " " << frame_num_target << " " << episode_num_target << " " << data_target << "\n"
+        << "rewards " << r.positive_feedback << " " << r.negative_feedback << " " << r.episode_success << " " << r.episode_failure
+        << " " << r.collision_penalty << " " << r.idle_penalty << " " << r.delay_penalty << " " << r.fairness_bonus << "\n"
+        << "seeds " << result_cache::seed_scheme << "\n";
+    return key.str();
+}
+
+class Result_Cache {
+public:
+    explicit Result_Cache(const std::string& dir = result_cache_dir) : dir(dir) {}
+
+    // result of `key` (see result_key()) into `data`, false if it is not cached
+    bool load(const std::string& key, Plot_Data& data) {
+        using namespace result_cache;
+        ++lookups;
+        Mapped_File file(path(key));
+        const char* at = file.data();
+        const char* end = at + file.size();
+        uint32_t header[7];
+        if (!at || file.size() < sizeof(header)) return false;
+        std::memcpy(header, at, sizeof(header));
+        at += sizeof(header);
+        if (header[0] != file_magic || header[1] != file_format || header[2] != key.size()) return false;
+        Plot_Data loaded;
+        size_t bytes = key.size();
+        for (int i = 0; i < 4; i++) {
+            if (header[3 + i] != series(loaded, i)->size()) return false;
+            bytes += header[3 + i] * sizeof(double);
+        }
+        if (static_cast<size_t>(end - at) != bytes || key.compare(0, key.size(), at, key.size()) != 0) return false;
+        at += key.size();
+        for (int i = 0; i < 4; i++) {
+            auto& values = *series(loaded, i);
+            std::memcpy(values.data(), at, values.size() * sizeof(double));
+            at += values.size() * sizeof(double);
+        }
+        data = std::move(loaded);
+        ++hits;
+        return true;
+    }
+
+    // Write through a temporary file, so readers never see half a result. Failing to store is not
+    // an error, the result is only trained again next time.
+    void store(const std::string& key, Plot_Data& data) {
+        using namespace result_cache;
+        make_dir(dir);
+        std::string target = path(key);
+        std::string temp = target + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary);
+            uint32_t header[7] = { file_magic, file_format, static_cast<uint32_t>(key.size()) };
+            for (int i = 0; i < 4; i++) {
+                header[3 + i] = static_cast<uint32_t>(series(data, i)->size());
+            }
+            file.write(reinterpret_cast<const char*>(header), sizeof(header));
+            file.write(key.data(), key.size());
+            for (int i = 0; i < 4; i++) {
+                auto& values = *series(data, i);
+                file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+            }
+            file.close();
+            if (!file) {
+                std::cerr << "result cache: cannot write " << temp << std::endl;
+                std::remove(temp.c_str());
+                return;
+            }
+        }
+        // rename() does not replace an existing file on Windows
+        std::remove(target.c_str());
+        if (std::rename(temp.c_str(), target.c_str()) != 0) {
+            std::cerr << "result cache: cannot write " << target << std::endl;
+            std::remove(temp.c_str());
+            return;
+        }
+        ++stores;
+    }
+
+    void report() const {
+        std::cout << "Result cache " << dir << ": " << hits << " of " << lookups << " results cached, "
+             << stores << " stored" << std::endl;
+    }
+
+private:
+    std::string path(const std::string& key) const {
+        std::stringstream name;
+        name << dir << "/" << std::hex << std::setw(16) << std::setfill('0') << result_cache::hash(key) << ".plot";
+        return name.str();
+    }
+
+    std::string dir;
+    int lookups = 0;
+    int hits = 0;
+    int stores = 0;
+};
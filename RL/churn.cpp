@@ -0,0 +1 @@
+#include "churn.h"
@@ -0,0 +1,411 @@
+#pragma once
+#include "include.h"
+
+// Stable reference to a pooled item, stale once the item is released
+struct Pool_Handle {
+    int index = -1;
+    uint32_t generation = 0;
+};
+
+// Fixed pool of `Capacity` items with a free list and a list of the active indices
+// acquire() and release() are O(1) and never allocate. Released items keep their storage and
+// are handed out again, so callers reset what they need. The active list is unordered, a release
+// moves the last active index into the freed position. Every release bumps the item's
+// generation, so handles of a departed item no longer resolve even after the index is reused.
+template <typename T, int Capacity>
+class Node_Pool {
+public:
+    class Active_Iterator {
+    public:
+        Active_Iterator(const Node_Pool* pool, const int* at) : pool(pool), at(at) {}
+        const T& operator*() const { return pool->items[*at]; }
+        Active_Iterator& operator++() { ++at; return *this; }
+        bool operator!=(const Active_Iterator& other) const { return at != other.at; }
+    private:
+        const Node_Pool* pool;
+        const int* at;
+    };
+    // the active items, for code that takes any range of them (see reward.h)
+    struct Active_Items {
+        const Node_Pool* pool;
+        Active_Iterator begin() const { return { pool, pool->active_list.data() }; }
+        Active_Iterator end() const { return { pool, pool->active_list.data() + pool->active_count }; }
+    };
+
+    Node_Pool() {
+        position.fill(-1);
+        clear();
+    }
+    // every item free, handles from before stay stale
+    void clear() {
+        for (int i = 0; i < Capacity; i++) {
+            if (is_active(i)) ++generation[i];
+            free_list[i] = Capacity - 1 - i;
+            position[i] = -1;
+        }
+        free_count = Capacity;
+        active_count = 0;
+    }
+    bool full() const {
+        return free_count == 0;
+    }
+    int size() const {
+        return active_count;
+    }
+
+    // the lowest free index is handed out first after a clear(), none if the pool is full
+    Pool_Handle acquire() {
+        if (free_count == 0) return Pool_Handle();
+        int index = free_list[--free_count];
+        position[index] = active_count;
+        active_list[active_count++] = index;
+        return { index, generation[index] };
+    }
+    void release(int index) {
+        int at = position[index];
+        int last = active_list[--active_count];
+        active_list[at] = last;
+        position[last] = at;
+        position[index] = -1;
+        ++generation[index];
+        free_list[free_count++] = index;
+    }
+
+    bool is_active(int index) const {
+        return position[index] >= 0;
+    }
+    bool valid(const Pool_Handle& handle) const {
+        return handle.index >= 0 && is_active(handle.index) && generation[handle.index] == handle.generation;
+    }
+    Pool_Handle handle(int index) const {
+        return { index, generation[index] };
+    }
+    T* get(const Pool_Handle& handle) {
+        return valid(handle) ? &items[handle.index] : nullptr;
+    }
+    T& operator[](int index) {
+        return items[index];
+    }
+    const T& operator[](int index) const {
+        return items[index];
+    }
+
+    // active indices, valid until the next acquire() or release()
+    const int* active_begin() const {
+        return active_list.data();
+    }
+    const int* active_end() const {
+        return active_list.data() + active_count;
+    }
+    // active index at position `i` of the active list
+    int active(int i) const {
+        return active_list[i];
+    }
+    Active_Items items_active() const {
+        return { this };
+    }
+
+private:
+    std::array<T, Capacity> items;
+    std::array<uint32_t, Capacity> generation = { 0 };
+    std::array<int, Capacity> free_list;
+    std::array<int, Capacity> active_list;
+    std::array<int, Capacity> position;     // in active_list, -1 if free
+    int free_count = 0;
+    int active_count = 0;
+};
+
+// TD (SARSA) over a network whose nodes come and go
+// Every iteration starts with NumNode nodes. After every frame each node leaves with probability
+// `departure` and a Poisson number of nodes with mean `arrival` joins, as long as the pool has room,
+// so the population settles around arrival / departure. A node that joins gets a fresh Q row and
+// data_target data, whatever it is given of the episode. Data of a node that leaves is lost.
+// Node state and Q rows are indexed by pool index and recycled through the pool, and every
+// per-frame kernel runs over the active list only.
+// Per-episode results count the data delivered and the nodes that were active at the end of the
+// episode with all of their data delivered.
+class SlottedAlohaRL_Churn {
+public:
+    SlottedAlohaRL_Churn(const double& arrival = churn_arrival_rate, const double& departure = churn_departure_prob,
+                         const double& epsilon = 0.1, const double& alpha = 0.1, const double& gamma = 0.6) :
+        arrival(arrival), departure(departure), epsilon(epsilon),
+        alpha(static_cast<float>(alpha)), gamma(static_cast<float>(gamma)), Q(churn_capacity * NumSlot)
+    {
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(2) << epsilon;
+        plot_str = "Churn TD(n=" + std::to_string(static_cast<int>(std::lround(arrival / std::max(departure, 1e-9))))
+                   + ", e=" + stream.str() + ")";
+        A_1().fill(-1);
+        A_2().fill(-1);
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    void train() {
+        std::ios::sync_with_stdio(false);
+        set_seed(get_seed());
+        for (int i = 0; i < iterations; i++) {
+            populate();
+            run_iteration();
+            change_seed();
+            reset();
+        }
+        calc_average();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+    // active nodes per frame, arrivals and departures over everything trained so far
+    double mean_population() const {
+        return frames ? static_cast<double>(population) / frames : 0.0;
+    }
+    unsigned long long get_arrivals() const {
+        return arrivals;
+    }
+    unsigned long long get_departures() const {
+        return departures;
+    }
+
+private:
+    struct Node {
+        friend class SlottedAlohaRL_Churn;
+    public:
+        unsigned int id = 0;                // arrival number within the iteration, for traces
+        unsigned int remaining_data = data_target;
+        bool is_success = false;
+
+        void reset() {
+            remaining_data = data_target;
+            is_success = false;
+        }
+    };
+
+    typedef Node_Pool<Node, churn_capacity> Pool;
+    typedef std::array<int, churn_capacity> Action;     // by pool index, -1 if silent or free
+    typedef std::array<double, churn_capacity> Reward;
+
+    float* row(int index) {
+        return Q.data() + index * NumSlot;
+    }
+
+    void run_iteration() {
+        for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
+            run_episode();
+        }
+    }
+
+    void run_episode() {
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        choose_action(A_1());
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            check_collision();
+            choose_action(A_2());
+            update();
+            // membership changes between frames, a node that joins acts from the next frame on
+            churn();
+            current ^= 1;
+        }
+
+        bool is_complete = true;
+        for (auto at = pool.active_begin(); at != pool.active_end(); ++at) {
+            pool[*at].is_success ? ++success_node : is_complete = false;
+        }
+        is_complete ? ++total_success : ++total_failure;
+        TRACE_COUNTER(1, "total_success", total_success);
+        TRACE_COUNTER(1, "total_failure", total_failure);
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+
+        final_reward();
+        data.success_data[episode_num] += success_data;
+        data.success_node[episode_num] += success_node;
+        data.cum_reward[episode_num] += cur_reward;
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+        for (auto at = pool.active_begin(); at != pool.active_end(); ++at) {
+            pool[*at].reset();
+        }
+    }
+
+    void choose_action(Action& action) {
+        PROFILE_SCOPE(Choose_Action);
+        for (auto at = pool.active_begin(); at != pool.active_end(); ++at) {
+            auto& node = pool[*at];
+            if (node.remaining_data == 0) {
+                action[*at] = -1;
+            }
+            else if (explore[episode_num] >= get_rand_real(0, 1)) {
+                action[*at] = get_rand_int(0, NumSlot - 1);
+            }
+            else {
+                const float* q = row(*at);
+                action[*at] = static_cast<int>(std::max_element(q, q + NumSlot) - q);
+            }
+        }
+    }
+
+    void check_collision() {
+        PROFILE_SCOPE(Collision);
+        std::array<int, NumSlot> occupancy = { 0 };
+        for (auto at = pool.active_begin(); at != pool.active_end(); ++at) {
+            if (A_1()[*at] >= 0) ++occupancy[A_1()[*at]];
+        }
+        double idle = rewards.idle(A_1());
+        for (auto at = pool.active_begin(); at != pool.active_end(); ++at) {
+            auto& node = pool[*at];
+            if (A_1()[*at] < 0) continue;
+            bool success = occupancy[A_1()[*at]] == 1;
+            if (success) {
+                --node.remaining_data;
+                ++success_data;
+                ++success_frame;
+                if (node.remaining_data == 0) {
+                    node.is_success = true;
+                }
+            }
+            reward[*at] = rewards.step(success, node.remaining_data) + idle;
+        }
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[frame_num_data++] += success_frame;
+        success_frame = 0;
+    }
+
+    // SARSA on A_1 -> A_2 for the nodes that sent
+    void update() {
+        PROFILE_SCOPE(Update);
+        for (auto at = pool.active_begin(); at != pool.active_end(); ++at) {
+            if (A_1()[*at] < 0) continue;
+            float* q = row(*at);
+            float next = A_2()[*at] >= 0 ? q[A_2()[*at]] : 0.0f;
+            float target = static_cast<float>(reward[*at]) + gamma * next;
+            q[A_1()[*at]] += alpha * (target - q[A_1()[*at]]);
+            cur_reward += reward[*at];
+        }
+    }
+
+    // departures first, so a node that leaves cannot hand its index to one that joins the same frame
+    void churn() {
+        ++frames;
+        population += pool.size();
+        // backwards, a release moves the last active index into the freed position
+        for (int i = pool.size() - 1; i >= 0; i--) {
+            int index = pool.active(i);
+            if (get_rand_real(0, 1) < departure) {
+                TRACE_INSTANT(3, "leave", "node", pool[index].id);
+                // silent in both buffers, choose_action() only writes active nodes
+                A_1()[index] = A_2()[index] = -1;
+                pool.release(index);
+                ++departures;
+            }
+        }
+        // a Poisson mean has to be positive, an arrival rate of 0 means nobody joins
+        int joining = arrival > 0 ? std::poisson_distribution<int>(arrival)(e) : 0;
+        for (int j = 0; j < joining && !pool.full(); j++) {
+            join();
+        }
+        TRACE_COUNTER(2, "population", pool.size());
+    }
+
+    void join() {
+        Pool_Handle handle = pool.acquire();
+        auto& node = pool[handle.index];
+        node.reset();
+        node.id = next_id++;
+        float* q = row(handle.index);
+        for (int s = 0; s < NumSlot; s++) {
+            q[s] = static_cast<float>(get_rand_real(-1, 1));
+        }
+        A_2()[handle.index] = -1;
+        ++arrivals;
+        TRACE_INSTANT(3, "join", "node", node.id);
+    }
+
+    // terminal reward at the greedy slot of every node that is still there
+    void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        double bonus = rewards.episode_bonus(pool.items_active());
+        for (auto at = pool.active_begin(); at != pool.active_end(); ++at) {
+            float* q = row(*at);
+            double reward = rewards.final(pool[*at].is_success, bonus);
+            *std::max_element(q, q + NumSlot) += static_cast<float>(reward);
+            cur_reward += reward;
+        }
+    }
+
+    void populate() {
+        pool.clear();
+        next_id = 0;
+        A_1().fill(-1);
+        A_2().fill(-1);
+        for (int n = 0; n < NumNode; n++) {
+            join();
+        }
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
+    }
+
+    void reset() {
+        frame_num_data = 0;
+        cur_reward = 0;
+    }
+
+    std::string plot_str;
+
+    Pool pool;
+    // actions of the current and the next frame, a frame ends by flipping `current` instead of copying
+    std::array<Action, 2> actions;
+    int current = 0;
+    Action& A_1() { return actions[current]; }
+    Action& A_2() { return actions[current ^ 1]; }
+    Reward reward = { 0.0 };
+    Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+
+    double arrival = churn_arrival_rate;
+    double departure = churn_departure_prob;
+    double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
+    float alpha = 0.1f;
+    float gamma = 0.6f;
+
+    std::vector<float> Q;                       // [churn_capacity x NumSlot], by pool index
+
+    int success_frame = 0;
+    int success_data = 0;
+    int success_node = 0;
+
+    unsigned int next_id = 0;
+    unsigned long long frames = 0;
+    unsigned long long population = 0;
+    unsigned long long arrivals = 0;
+    unsigned long long departures = 0;
+
+    unsigned int total_success = 0;
+    unsigned int total_failure = 0;
+    unsigned int frame_num = 0;
+    unsigned int frame_num_data = 0;
+    unsigned int episode_num = 0;
+
+    double cur_reward = 0;
+};
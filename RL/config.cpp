@@ -0,0 +1 @@
+#include "config.h"
\ No newline at end of file
@@ -0,0 +1,583 @@
+#pragma once
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+#include "json.h"
+#include "TD.h"
+#include "RL.h"
+#include "nstep.h"
+#include "sarsa_ramda.h"
+#include "stateful.h"
+#include "linear.h"
+#include "shared.h"
+#include "dqn.h"
+#include "parallel.h"
+#include "bandit.h"
+#include "dynamic.h"
+#include "churn.h"
+#include "baselines.h"
+#include "batch.h"
+#include "scheduler.h"
+#include "distributed.h"
+
+// Experiment configs
+// A JSON file describes the learners of a sweep, the rewards, how the sweep runs and where its
+// results go, so new experiments do not need a rebuild. load_experiment() validates the whole file
+// before anything trains. Every error names the offending key, e.g. "learners[2].epsilon".
+//
+// NumNode, NumSlot and the frame and episode counts size arrays at compile time. A config can only
+// state the sizes it expects in "sizes", and is rejected if the binary was built with others.
+//
+// {
+//   "title": "...", "iterations": 40, "threads": 0, "processes": 0,
+//   "sizes": { "nodes": 10, "slots": 10, "frames": 10, "episodes": 150, "data": 10 },
+//   "rewards": { "success": 1, "collision": 0, "episode_success": 10, "episode_failure": 0,
+//                "collision_penalty": 0, "idle_penalty": 0, "delay_penalty": 0, "fairness_bonus": 0 },
+//   "output": { "plot": true, "csv": "results.csv", "trace": "trace.json", "profile": true, "throughput": true,
+//               "profile_csv": "profile.csv", "cache": "results" },
+//   "learners": [ { "type": "td", "label": "TD", "cost": 1, "iterations": 40, "epsilon": [0.05, 0.5] } ]
+// }
+// A learner parameter given as an array adds one learner per value, several arrays add every
+// combination. Their labels get the values appended, e.g. "TD(epsilon=0.05)".
+// Results are cached by learner type, parameters and iterations in the "cache" directory (see
+// cache.h), an empty "cache" trains every learner.
+
+// One learner of a sweep, its parameters are checked against the schema of its type
+struct Learner_Config {
+    std::string type;
+    std::string label;
+    double cost = 1.0;
+    int iterations = iterations_target;
+    std::map<std::string, Json> params;
+
+    double number(const std::string& key, double fallback) const {
+        auto it = params.find(key);
+        return it == params.end() ? fallback : it->second.number();
+    }
+    bool flag(const std::string& key, bool fallback) const {
+        auto it = params.find(key);
+        return it == params.end() ? fallback : it->second.boolean();
+    }
+    std::string name(const std::string& key, const std::string& fallback) const {
+        auto it = params.find(key);
+        return it == params.end() ? fallback : it->second.string();
+    }
+};
+
+struct Experiment {
+    std::string title = "Comparison of RL Algorithms via Slotted ALOHA";
+    int threads = 0;                // sweep threads, 0 for one per hardware thread
+    int processes = 0;              // worker processes instead of threads if > 0 (see distributed.h)
+    Reward_Constants rewards;
+    bool plot = true;
+    bool profile = true;
+    std::string profile_csv;        // per-thread profile rows are appended here, none if empty
+    bool throughput = true;         // fraction of the TDMA oracle and of optimal ALOHA (see baselines.h)
+    std::string csv;                // per-episode results of every learner, none if empty
+    std::string trace;              // Chrome trace, needs TRACE_LEVEL > 0
+    std::string cache = result_cache_dir;   // result cache directory, none if empty
+    std::vector<Learner_Config> learners;
+};
+
+namespace config {
+
+enum class Kind { Number, Integer, Bool, Choice };
+
+// Number and Integer values have to lie in [min, max], or [min, max) if `below_max`
+struct Param {
+    const char* name;
+    Kind kind;
+    std::vector<std::string> choices;
+    double min = 0;
+    double max = std::numeric_limits<double>::infinity();
+    bool below_max = false;
+};
+
+// parameters every learner type accepts, besides type, label, cost and iterations
+inline const std::map<std::string, std::vector<Param>>& schemas() {
+    static const std::vector<std::string> sampling = { "uniform", "prioritized" };
+    static const Param epsilon = { "epsilon", Kind::Number, {}, 0, 1 };
+    static const Param alpha = { "alpha", Kind::Number, {}, 0, 1 };
+    // several learners start Q at positive_feedback / (1 - gamma), which a discount of 1 makes infinite
+    static const Param gamma = { "gamma", Kind::Number, {}, 0, 1, true };
+    static const std::map<std::string, std::vector<Param>> all = {
+        { "mc", { epsilon } },
+        { "td", { epsilon,
+                  { "target", Kind::Choice, { "sarsa", "q_learning", "expected_sarsa", "double_q" } },
+                  { "storage", Kind::Choice, { "double", "float", "fixed16" } },
+                  { "replay_batch", Kind::Integer, {} },
+                  { "sampling", Kind::Choice, sampling },
+                  { "exploration", Kind::Choice, { "epsilon_greedy", "softmax", "ucb", "optimistic" } },
+                  { "schedule", Kind::Choice, { "harmonic", "linear", "exponential", "constant" } } } },
+        { "nstep", { { "n", Kind::Integer, {}, 1 }, alpha, gamma } },
+        { "ramda", { { "lambda", Kind::Number, {}, 0, 1 }, alpha, gamma } },
+        { "stateful", { epsilon, alpha, gamma } },
+        { "linear", { epsilon, alpha, gamma } },
+        { "shared", { epsilon, { "conditioned", Kind::Bool, {} }, alpha, gamma } },
+        { "dqn", { epsilon, gamma, { "sampling", Kind::Choice, sampling } } },
+        { "bandit", { { "policy", Kind::Choice, { "thompson", "ucb1" } }, { "c", Kind::Number, {} } } },
+        { "dynamic", { { "estimator", Kind::Choice, { "fixed", "schoute", "vogt", "exact" } }, { "slots", Kind::Integer, {}, 1 },
+                       epsilon, alpha, gamma } },
+        { "churn", { { "arrival", Kind::Number, {} }, { "departure", Kind::Number, {}, 0, 1 }, epsilon, alpha, gamma } },
+        { "baseline", { { "policy", Kind::Choice, { "aloha", "tdma" } } } },
+        { "batch", { epsilon, alpha, gamma } },
+        // 0 threads is one per core, 0 slots is one per node
+        { "parallel", { { "nodes", Kind::Integer, {}, 1 }, { "threads", Kind::Integer, {} }, { "slots", Kind::Integer, {} },
+                        epsilon, alpha, gamma } },
+    };
+    return all;
+}
+
+[[noreturn]] inline void fail(const std::string& path, const std::string& what) {
+    throw std::runtime_error("config " + path + ": " + what);
+}
+
+inline const Json& expect(const Json& value, Json::Type type, const std::string& path) {
+    if (value.type() != type) {
+        fail(path, std::string("expected ") + Json::type_name(type) + ", got " + Json::type_name(value.type()));
+    }
+    return value;
+}
+
+inline double number(const Json& value, const std::string& path) {
+    return expect(value, Json::Type::Number, path).number();
+}
+
+inline int integer(const Json& value, const std::string& path, int min) {
+    double x = number(value, path);
+    if (x != std::floor(x) || x < min || x > std::numeric_limits<int>::max()) {
+        fail(path, "expected an integer >= " + std::to_string(min));
+    }
+    return static_cast<int>(x);
+}
+
+// every key of `object` has to be one of `keys`
+inline void known_keys(const Json& object, const std::vector<std::string>& keys, const std::string& path) {
+    for (auto& member : object.object()) {
+        if (std::find(keys.begin(), keys.end(), member.first) == keys.end()) {
+            fail(path.empty() ? member.first : path + "." + member.first, "unknown key");
+        }
+    }
+}
+
+inline void check_param(const Param& param, const Json& value, const std::string& path) {
+    switch (param.kind) {
+    case Kind::Number: {
+        double x = number(value, path);
+        if (x < param.min || x > param.max || (param.below_max && x == param.max)) {
+            std::stringstream range;
+            range << "expected a number ";
+            if (param.max == std::numeric_limits<double>::infinity()) range << ">= " << param.min;
+            else range << "in [" << param.min << ", " << param.max << (param.below_max ? ")" : "]");
+            fail(path, range.str());
+        }
+        break;
+    }
+    case Kind::Integer:
+        integer(value, path, static_cast<int>(param.min));
+        break;
+    case Kind::Bool:
+        expect(value, Json::Type::Bool, path);
+        break;
+    case Kind::Choice: {
+        auto& name = expect(value, Json::Type::String, path).string();
+        if (std::find(param.choices.begin(), param.choices.end(), name) == param.choices.end()) {
+            std::string list;
+            for (auto& choice : param.choices) {
+                list += (list.empty() ? "" : ", ") + choice;
+            }
+            fail(path, "\"" + name + "\" is not one of " + list);
+        }
+        break;
+    }
+    }
+}
+
+inline std::string format(const Json& value) {
+    if (value.is_string()) return value.string();
+    if (value.is_bool()) return value.boolean() ? "true" : "false";
+    std::stringstream stream;
+    stream << value.number();
+    return stream.str();
+}
+
+// one Learner_Config per combination of the array-valued parameters of learners[index]
+inline void parse_learner(const Json& spec, int index, int iterations, std::vector<Learner_Config>& out) {
+    std::string path = "learners[" + std::to_string(index) + "]";
+    expect(spec, Json::Type::Object, path);
+    const Json* type = spec.find("type");
+    if (!type) fail(path, "missing \"type\"");
+    Learner_Config base;
+    base.type = expect(*type, Json::Type::String, path + ".type").string();
+    auto schema = schemas().find(base.type);
+    if (schema == schemas().end()) {
+        std::string list;
+        for (auto& entry : schemas()) {
+            list += (list.empty() ? "" : ", ") + entry.first;
+        }
+        fail(path + ".type", "\"" + base.type + "\" is not one of " + list);
+    }
+    base.label = base.type;
+    base.iterations = iterations;
+
+    // parameters with a list of values, expanded below
+    std::vector<std::pair<std::string, const std::vector<Json>*>> axes;
+    for (auto& member : spec.object()) {
+        auto& key = member.first;
+        auto& value = member.second;
+        std::string at = path + "." + key;
+        if (key == "type") continue;
+        if (key == "label") {
+            base.label = expect(value, Json::Type::String, at).string();
+            continue;
+        }
+        if (key == "cost") {
+            base.cost = number(value, at);
+            if (base.cost <= 0) fail(at, "expected a number > 0");
+            continue;
+        }
+        if (key == "iterations") {
+            base.iterations = integer(value, at, 1);
+            continue;
+        }
+        auto param = std::find_if(schema->second.begin(), schema->second.end(), [&key](const Param& p) { return key == p.name; });
+        if (param == schema->second.end()) {
+            fail(at, "unknown parameter of a \"" + base.type + "\" learner");
+        }
+        if (value.is_array()) {
+            if (value.array().empty()) fail(at, "empty list of values");
+            for (size_t i = 0; i < value.array().size(); i++) {
+                check_param(*param, value.array()[i], at + "[" + std::to_string(i) + "]");
+            }
+            axes.emplace_back(key, &value.array());
+        }
+        else {
+            check_param(*param, value, at);
+            base.params[key] = value;
+        }
+    }
+
+    // odometer over the axes, the last one turns fastest
+    std::vector<size_t> pick(axes.size(), 0);
+    while (true) {
+        Learner_Config learner = base;
+        std::string suffix;
+        for (size_t a = 0; a < axes.size(); a++) {
+            auto& value = (*axes[a].second)[pick[a]];
+            learner.params[axes[a].first] = value;
+            suffix += (suffix.empty() ? "" : ", ") + axes[a].first + "=" + format(value);
+        }
+        if (!suffix.empty()) {
+            learner.label += "(" + suffix + ")";
+        }
+        if (learner.type == "td" && learner.number("replay_batch", 0) > 0 && learner.name("target", "sarsa") == "sarsa") {
+            fail(path + ".replay_batch", "SARSA targets are never replayed, choose another target");
+        }
+        out.push_back(learner);
+
+        size_t a = axes.size();
+        while (a > 0 && ++pick[a - 1] == axes[a - 1].second->size()) {
+            pick[--a] = 0;
+        }
+        if (a == 0) break;
+    }
+}
+
+inline void check_sizes(const Json& sizes) {
+    expect(sizes, Json::Type::Object, "sizes");
+    known_keys(sizes, { "nodes", "slots", "frames", "episodes", "data" }, "sizes");
+    std::pair<const char*, int> built[] = {
+        { "nodes", NumNode }, { "slots", NumSlot }, { "frames", frame_num_target },
+        { "episodes", episode_num_target }, { "data", data_target } };
+    for (auto& size : built) {
+        const Json* value = sizes.find(size.first);
+        if (!value) continue;
+        std::string at = std::string("sizes.") + size.first;
+        if (integer(*value, at, 1) != size.second) {
+            fail(at, "this binary was built with " + std::to_string(size.second)
+                     + ", change global.h and rebuild to run " + format(*value));
+        }
+    }
+}
+
+inline void parse_rewards(const Json& rewards, Reward_Constants& out) {
+    expect(rewards, Json::Type::Object, "rewards");
+    known_keys(rewards, { "success", "collision", "episode_success", "episode_failure",
+                          "collision_penalty", "idle_penalty", "delay_penalty", "fairness_bonus" }, "rewards");
+    std::pair<const char*, double*> fields[] = {
+        { "success", &out.positive_feedback }, { "collision", &out.negative_feedback },
+        { "episode_success", &out.episode_success }, { "episode_failure", &out.episode_failure },
+        { "collision_penalty", &out.collision_penalty }, { "idle_penalty", &out.idle_penalty },
+        { "delay_penalty", &out.delay_penalty }, { "fairness_bonus", &out.fairness_bonus } };
+    for (auto& field : fields) {
+        if (const Json* value = rewards.find(field.first)) {
+            *field.second = number(*value, std::string("rewards.") + field.first);
+        }
+    }
+}
+
+inline void parse_output(const Json& output, Experiment& out) {
+    expect(output, Json::Type::Object, "output");
+    known_keys(output, { "plot", "csv", "trace", "profile", "profile_csv", "throughput", "cache" }, "output");
+    if (const Json* value = output.find("plot")) out.plot = expect(*value, Json::Type::Bool, "output.plot").boolean();
+    if (const Json* value = output.find("profile")) out.profile = expect(*value, Json::Type::Bool, "output.profile").boolean();
+    if (const Json* value = output.find("throughput")) out.throughput = expect(*value, Json::Type::Bool, "output.throughput").boolean();
+    if (const Json* value = output.find("csv")) out.csv = expect(*value, Json::Type::String, "output.csv").string();
+    if (const Json* value = output.find("trace")) out.trace = expect(*value, Json::Type::String, "output.trace").string();
+    if (const Json* value = output.find("profile_csv")) out.profile_csv = expect(*value, Json::Type::String, "output.profile_csv").string();
+    if (const Json* value = output.find("cache")) out.cache = expect(*value, Json::Type::String, "output.cache").string();
+}
+
+// type and parameters of `learner` for result_key(), labels and costs do not change results
+inline std::string learner_key(const Learner_Config& learner) {
+    std::stringstream key;
+    key << learner.type << std::setprecision(17);
+    for (auto& param : learner.params) {
+        key << " " << param.first << "=";
+        if (param.second.is_string() || param.second.is_bool()) {
+            key << format(param.second);
+        }
+        else {
+            key << param.second.number();
+        }
+    }
+    return key.str();
+}
+
+inline Sampling sampling(const Learner_Config& learner) {
+    return learner.name("sampling", "uniform") == "prioritized" ? Sampling::Prioritized : Sampling::Uniform;
+}
+
+inline Exploration exploration(const Learner_Config& learner) {
+    auto name = learner.name("exploration", "epsilon_greedy");
+    if (name == "softmax") return Exploration::Softmax;
+    if (name == "ucb") return Exploration::UCB;
+    if (name == "optimistic") return Exploration::Optimistic;
+    return Exploration::Epsilon_Greedy;
+}
+
+inline Frame_Estimator frame_estimator(const Learner_Config& learner) {
+    auto name = learner.name("estimator", "vogt");
+    if (name == "fixed") return Frame_Estimator::Fixed;
+    if (name == "schoute") return Frame_Estimator::Schoute;
+    if (name == "exact") return Frame_Estimator::Exact;
+    return Frame_Estimator::Vogt;
+}
+
+inline Schedule schedule(const Learner_Config& learner) {
+    auto name = learner.name("schedule", "harmonic");
+    if (name == "linear") return Schedule::Linear;
+    if (name == "exponential") return Schedule::Exponential;
+    if (name == "constant") return Schedule::Constant;
+    return Schedule::Harmonic;
+}
+
+template <typename Value, TD_Target Target>
+void add_td(Sweep& sweep, const Learner_Config& learner) {
+    double epsilon = learner.number("epsilon", 0.1);
+    int batch = static_cast<int>(learner.number("replay_batch", 0));
+    Sampling mode = sampling(learner);
+    Exploration policy = exploration(learner);
+    Schedule decay = schedule(learner);
+    sweep.add(learner.label, learner.cost, [epsilon, batch, mode, policy, decay] {
+        SlottedAlohaRL_TD<Value, Target> td(epsilon);
+        td.set_exploration(policy, decay);
+        if (batch > 0) {
+            td.enable_replay(batch, mode);
+        }
+        return td;
+    }, learner.iterations);
+}
+
+template <typename Value>
+void add_td(Sweep& sweep, const Learner_Config& learner) {
+    auto target = learner.name("target", "sarsa");
+    if (target == "q_learning") add_td<Value, TD_Target::Q_Learning>(sweep, learner);
+    else if (target == "expected_sarsa") add_td<Value, TD_Target::Expected_Sarsa>(sweep, learner);
+    else if (target == "double_q") add_td<Value, TD_Target::Double_Q>(sweep, learner);
+    else add_td<Value, TD_Target::Sarsa>(sweep, learner);
+}
+
+// the learner with its parameters as a job of `sweep`, defaults are those of the constructors
+inline void add_learner(Sweep& sweep, const Learner_Config& learner) {
+    double epsilon = learner.number("epsilon", 0.1);
+    double alpha = learner.number("alpha", 0.1);
+    double gamma = learner.number("gamma", 0.6);
+    const auto& type = learner.type;
+    if (type == "mc") {
+        sweep.add(learner.label, learner.cost, [epsilon] { return SlottedAlohaRL_MC(epsilon); }, learner.iterations);
+    }
+    else if (type == "td") {
+        auto storage = learner.name("storage", "double");
+        if (storage == "float") add_td<float>(sweep, learner);
+        else if (storage == "fixed16") add_td<Fixed16<>>(sweep, learner);
+        else add_td<double>(sweep, learner);
+    }
+    else if (type == "nstep") {
+        unsigned int n = static_cast<unsigned int>(learner.number("n", 1));
+        sweep.add(learner.label, learner.cost, [n, alpha, gamma] { return SlottedAlohaRL_n(n, alpha, gamma); }, learner.iterations);
+    }
+    else if (type == "ramda") {
+        double lambda = learner.number("lambda", 1);
+        sweep.add(learner.label, learner.cost, [lambda, alpha, gamma] { return SlottedAlohaRL_Ramda(lambda, alpha, gamma); }, learner.iterations);
+    }
+    else if (type == "stateful") {
+        sweep.add(learner.label, learner.cost, [epsilon, alpha, gamma] { return SlottedAlohaRL_State(epsilon, alpha, gamma); }, learner.iterations);
+    }
+    else if (type == "linear") {
+        sweep.add(learner.label, learner.cost, [epsilon, alpha, gamma] { return SlottedAlohaRL_Linear(epsilon, alpha, gamma); }, learner.iterations);
+    }
+    else if (type == "shared") {
+        bool conditioned = learner.flag("conditioned", true);
+        sweep.add(learner.label, learner.cost, [epsilon, conditioned, alpha, gamma] {
+            return SlottedAlohaRL_Shared(epsilon, conditioned, alpha, gamma);
+        }, learner.iterations);
+    }
+    else if (type == "dqn") {
+        Sampling mode = sampling(learner);
+        sweep.add(learner.label, learner.cost, [epsilon, gamma, mode] {
+            SlottedAlohaRL_DQN dqn(epsilon, gamma);
+            dqn.set_sampling(mode);
+            return dqn;
+        }, learner.iterations);
+    }
+    else if (type == "bandit") {
+        Bandit policy = learner.name("policy", "thompson") == "ucb1" ? Bandit::UCB1 : Bandit::Thompson;
+        double c = learner.number("c", 0.25);
+        sweep.add(learner.label, learner.cost, [policy, c] { return SlottedAlohaRL_Bandit(policy, c); }, learner.iterations);
+    }
+    else if (type == "dynamic") {
+        Frame_Estimator estimator = frame_estimator(learner);
+        int slots = static_cast<int>(learner.number("slots", NumSlot));
+        sweep.add(learner.label, learner.cost, [estimator, slots, epsilon, alpha, gamma] {
+            return SlottedAlohaRL_Dynamic(estimator, slots, epsilon, alpha, gamma);
+        }, learner.iterations);
+    }
+    else if (type == "churn") {
+        double arrival = learner.number("arrival", churn_arrival_rate);
+        double departure = learner.number("departure", churn_departure_prob);
+        sweep.add(learner.label, learner.cost, [arrival, departure, epsilon, alpha, gamma] {
+            return SlottedAlohaRL_Churn(arrival, departure, epsilon, alpha, gamma);
+        }, learner.iterations);
+        sweep.set_sizes(sweep.size() - 1, 0, NumSlot);
+    }
+    else if (type == "baseline") {
+        Baseline policy = learner.name("policy", "tdma") == "aloha" ? Baseline::ALOHA : Baseline::TDMA;
+        sweep.add(learner.label, learner.cost, [policy] { return SlottedAlohaRL_Baseline(policy); }, learner.iterations);
+    }
+    else if (type == "batch") {
+        sweep.add(learner.label, learner.cost, [epsilon, alpha, gamma] {
+            return SlottedAlohaRL_Batch<>(epsilon, alpha, gamma);
+        }, learner.iterations);
+    }
+    else if (type == "parallel") {
+        int nodes = static_cast<int>(learner.number("nodes", parallel_nodes));
+        int threads = static_cast<int>(learner.number("threads", parallel_threads));
+        int slots = static_cast<int>(learner.number("slots", 0));
+        sweep.add(learner.label, learner.cost, [nodes, threads, slots, epsilon, alpha, gamma] {
+            return SlottedAlohaRL_Parallel(nodes, threads, slots, epsilon, alpha, gamma);
+        }, learner.iterations);
+        sweep.set_sizes(sweep.size() - 1, nodes, SlottedAlohaRL_Parallel::frame_slots(nodes, slots));
+    }
+}
+
+inline void write_csv(const std::string& path, const Sweep& sweep) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("cannot write " + path);
+    }
+    file << "label,episode,success_data,success_node,cum_reward\n";
+    for (int j = 0; j < sweep.size(); j++) {
+        auto& data = sweep.result(j);
+        for (int ep = 0; ep < episode_num_target; ep++) {
+            file << '"' << sweep.label(j) << "\"," << ep << ',' << data.success_data[ep] << ','
+                 << data.success_node[ep] << ',' << data.cum_reward[ep] << '\n';
+        }
+    }
+}
+
+}   // namespace config
+
+// Parse and validate the experiment in `text`
+inline Experiment parse_experiment(const std::string& text) {
+    using namespace config;
+    Json doc = Json::parse(text);
+    expect(doc, Json::Type::Object, "document");
+    known_keys(doc, { "title", "iterations", "threads", "processes", "sizes", "rewards", "output", "learners" }, "");
+
+    Experiment experiment;
+    int iterations = iterations_target;
+    if (const Json* value = doc.find("title")) experiment.title = expect(*value, Json::Type::String, "title").string();
+    if (const Json* value = doc.find("iterations")) iterations = integer(*value, "iterations", 1);
+    if (const Json* value = doc.find("threads")) experiment.threads = integer(*value, "threads", 0);
+    if (const Json* value = doc.find("processes")) experiment.processes = integer(*value, "processes", 0);
+    if (const Json* value = doc.find("sizes")) check_sizes(*value);
+    if (const Json* value = doc.find("rewards")) parse_rewards(*value, experiment.rewards);
+    if (const Json* value = doc.find("output")) parse_output(*value, experiment);
+
+    const Json* learners = doc.find("learners");
+    if (!learners) fail("learners", "missing");
+    expect(*learners, Json::Type::Array, "learners");
+    for (size_t i = 0; i < learners->array().size(); i++) {
+        parse_learner(learners->array()[i], static_cast<int>(i), iterations, experiment.learners);
+    }
+    if (experiment.learners.empty()) fail("learners", "no learners to run");
+    return experiment;
+}
+
+inline Experiment load_experiment(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("cannot read " + path);
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    try {
+        return parse_experiment(text.str());
+    }
+    catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+// Train every learner of `experiment` and write its outputs
+inline void run_experiment(const Experiment& experiment) {
+    reward_constants() = experiment.rewards;
+    Sweep sweep;
+    Result_Cache cache(experiment.cache);
+    if (!experiment.cache.empty()) {
+        sweep.set_cache(&cache);
+    }
+    for (auto& learner : experiment.learners) {
+        config::add_learner(sweep, learner);
+        sweep.set_key(sweep.size() - 1, config::learner_key(learner));
+    }
+    if (experiment.processes > 0) {
+        run_processes(sweep, experiment.processes);
+    }
+    else {
+        Scheduler scheduler(experiment.threads);
+        sweep.run(scheduler);
+    }
+    if (experiment.profile) {
+        profile::report("sweep", experiment.profile_csv);
+    }
+    if (!experiment.cache.empty()) {
+        cache.report();
+    }
+    if (experiment.throughput) {
+        throughput_report(sweep);
+    }
+    if (!experiment.csv.empty()) {
+        config::write_csv(experiment.csv, sweep);
+    }
+    if (!experiment.trace.empty()) {
+        TRACE_WRITE(experiment.trace);
+    }
+    if (experiment.plot) {
+        sweep.plot();
+        plt::suptitle(experiment.title);
+        plt::show();
+    }
+}
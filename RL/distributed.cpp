@@ -0,0 +1 @@
+#include "distributed.h"
@@ -0,0 +1,205 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "scheduler.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <cerrno>
+#endif
+
+// Coordinator/worker mode for sweeps
+// The coordinator cuts a Sweep into chunks, deals them to `workers` local worker processes by
+// estimated cost, and forks the workers with a pipe each. A worker trains its chunks one after
+// another and streams every chunk's Plot_Data back as soon as it is done. The coordinator puts
+// each one into its (job, chunk) slot and merges them in order once every worker has finished.
+// Chunk records only carry numbers, so the pipes can be swapped for sockets to other machines.
+//
+// Record: magic, job, chunk, then the four Plot_Data series, each as a length and that many doubles.
+// Windows has no fork(), there the chunks run on an in-process Scheduler with `workers` threads.
+
+namespace distributed {
+
+constexpr uint32_t record_magic = 0x52444C50;  // "PLDR"
+
+// Plot_Data series in record order
+inline std::vector<double>* series(Plot_Data& data, int i) {
+    std::vector<double>* all[] = { &data.success_frame, &data.success_data, &data.success_node, &data.cum_reward };
+    return all[i];
+}
+
+inline void put(std::string& out, const void* src, size_t size) {
+    out.append(static_cast<const char*>(src), size);
+}
+
+inline std::string encode(int job, int chunk, Plot_Data& data) {
+    std::string out;
+    int32_t header[3] = { static_cast<int32_t>(record_magic), job, chunk };
+    put(out, header, sizeof(header));
+    for (int i = 0; i < 4; i++) {
+        auto& values = *series(data, i);
+        uint32_t size = static_cast<uint32_t>(values.size());
+        put(out, &size, sizeof(size));
+        put(out, values.data(), values.size() * sizeof(double));
+    }
+    return out;
+}
+
+#ifndef _WIN32
+
+inline void write_all(int fd, const std::string& bytes) {
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error("worker pipe closed");
+        done += static_cast<size_t>(n);
+    }
+}
+
+// false if the pipe is closed before the first byte
+inline bool read_all(int fd, void* dst, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::read(fd, static_cast<char*>(dst) + done, size - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 && done == 0) return false;
+        if (n <= 0) throw std::runtime_error("truncated record from worker");
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// one record from `fd` into its slot of `sweep`, false at the end of the stream
+inline bool receive(int fd, Sweep& sweep) {
+    int32_t header[3];
+    if (!read_all(fd, header, sizeof(header))) return false;
+    if (static_cast<uint32_t>(header[0]) != record_magic
+        || header[1] < 0 || header[1] >= sweep.size() || header[2] < 0 || header[2] >= sweep.chunks(header[1])) {
+        throw std::runtime_error("corrupt record from worker");
+    }
+    auto& data = sweep.chunk_data(header[1], header[2]);
+    for (int i = 0; i < 4; i++) {
+        auto& values = *series(data, i);
+        uint32_t size;
+        read_all(fd, &size, sizeof(size));
+        if (size != values.size()) {
+            throw std::runtime_error("worker was built with a different episode or frame count");
+        }
+        if (size > 0 && !read_all(fd, values.data(), size * sizeof(double))) {
+            throw std::runtime_error("truncated record from worker");
+        }
+    }
+    return true;
+}
+
+#endif
+
+}   // namespace distributed
+
+inline void run_processes(Sweep& sweep, int workers = 0) {
+    if (workers <= 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+#ifdef _WIN32
+    Scheduler scheduler(workers);
+    sweep.run(scheduler);
+#else
+    sweep.plan(workers);
+
+    // most expensive chunk first to the least loaded worker
+    struct Chunk { int job, chunk; double cost; };
+    std::vector<Chunk> chunks;
+    for (int j = 0; j < sweep.size(); j++) {
+        for (int c = 0; c < sweep.chunks(j); c++) {
+            chunks.push_back({ j, c, sweep.chunk_cost(j, c) });
+        }
+    }
+    std::stable_sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) { return a.cost > b.cost; });
+    std::vector<std::vector<Chunk>> assigned(workers);
+    std::vector<double> load(workers, 0.0);
+    for (auto& chunk : chunks) {
+        int w = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+        assigned[w].push_back(chunk);
+        load[w] += chunk.cost;
+    }
+
+    // buffered output would otherwise be written once more by every worker
+    std::cout.flush();
+    std::fflush(nullptr);
+    std::vector<pid_t> pids;
+    std::vector<pollfd> pipes;
+    for (int w = 0; w < workers; w++) {
+        if (assigned[w].empty()) continue;
+        int fd[2];
+        if (::pipe(fd) != 0) {
+            throw std::runtime_error("cannot create worker pipe");
+        }
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            throw std::runtime_error("cannot fork worker");
+        }
+        if (pid == 0) {
+            ::close(fd[0]);
+            for (auto& p : pipes) {
+                ::close(p.fd);
+            }
+            // a fork copies the coordinator's engines, every worker needs draws of its own
+            std::srand(change_seed());
+            int status = 0;
+            try {
+                for (auto& chunk : assigned[w]) {
+                    sweep.run_chunk(chunk.job, chunk.chunk);
+                    distributed::write_all(fd[1], distributed::encode(chunk.job, chunk.chunk, sweep.chunk_data(chunk.job, chunk.chunk)));
+                }
+            }
+            catch (const std::exception& e) {
+                std::cerr << "sweep worker " << w << ": " << e.what() << std::endl;
+                status = 1;
+            }
+            ::close(fd[1]);
+            // skip destructors and atexit handlers that belong to the coordinator
+            ::_exit(status);
+        }
+        ::close(fd[1]);
+        pids.push_back(pid);
+        pipes.push_back({ fd[0], POLLIN, 0 });
+    }
+
+    int received = 0;
+    int open = static_cast<int>(pipes.size());
+    while (open > 0) {
+        if (::poll(pipes.data(), pipes.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("poll on worker pipes failed");
+        }
+        for (auto& p : pipes) {
+            if (p.fd < 0 || !(p.revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (distributed::receive(p.fd, sweep)) {
+                ++received;
+            }
+            else {
+                ::close(p.fd);
+                p.fd = -1;
+                --open;
+            }
+        }
+    }
+
+    bool failed = false;
+    for (auto pid : pids) {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        failed = failed || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    if (failed || received != static_cast<int>(chunks.size())) {
+        throw std::runtime_error("sweep worker failed, " + std::to_string(received) + " of "
+                                 + std::to_string(chunks.size()) + " chunks received");
+    }
+    sweep.merge();
+#endif
+}
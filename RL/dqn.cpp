@@ -0,0 +1,2 @@
+#include "dqn.h"
+constexpr int SlottedAlohaRL_DQN::NumFeature;
\ No newline at end of file
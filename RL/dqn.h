@@ -0,0 +1,428 @@
+#pragma once
+#include "include.h"
+#include "observation.h"
+#include "experience.h"
+#include "TD.h"
+
+// DQN over the same features as the linear learner
+// A one-hidden-layer float MLP maps the one-hot (state, node) features of a node to its slot values.
+// Acting evaluates every node at once, Q = relu(Phi * W1 + b1) * W2 + b2 over Phi [NumNode x NumFeature],
+// and every frame takes one minibatch step from a shared replay buffer (uniform or prioritized)
+// against a target network that is copied from the online network every dqn_target_sync steps.
+// The products go through Eigen's GEMM, which is already cache blocked and vectorized on the CPU.
+class SlottedAlohaRL_DQN {
+public:
+    static constexpr int NumFeature = NumState + NumNode;
+
+    SlottedAlohaRL_DQN(const double& epsilon = 0.1, const double& gamma = 0.6) :
+        epsilon(epsilon), gamma(gamma), Phi(NumNode, NumFeature), X(dqn_batch, NumFeature), X_next(dqn_batch, NumFeature)
+    {
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(2) << epsilon;
+        plot_str = "DQN(e=" + stream.str() + ")";
+        int i = 0;
+        for (auto& node : nodes) {
+            node.node_num = i++;
+        }
+        replay.init(1, dqn_replay_capacity);
+        reset_net();
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    void train() {
+        train_until(iterations, 0.0);
+    }
+    // run whole iterations until `seconds` of wall-clock time are used up, at least one
+    // A budget that is not positive runs exactly one, train_until() would read it as no limit.
+    void train_for(double seconds) {
+        train_until(seconds > 0 ? std::numeric_limits<int>::max() : 1, seconds);
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // iterations averaged by the last train() or train_for()
+    int get_iterations() const {
+        return iterations;
+    }
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+    // Prioritized replay samples transitions by their last TD error and weights their gradient
+    // by the importance-sampling correction
+    void set_sampling(Sampling sampling) {
+        replay.init(1, dqn_replay_capacity, sampling);
+    }
+
+private:
+    struct Node {
+        friend class SlottedAlohaRL_DQN;
+    public:
+        unsigned int node_num;
+        unsigned int remaining_data = data_target;
+        bool is_success = false;
+        Outcome last_outcome = Outcome::Idle;
+
+        void reset() {
+            remaining_data = data_target;
+            is_success = false;
+            last_outcome = Outcome::Idle;
+        }
+    };
+
+    typedef std::array<int, NumNode> State;
+    typedef std::array<int, NumNode> Action;
+    typedef std::array<Node, NumNode> NodeArr;
+    typedef std::array<double, NumNode> Reward;
+    typedef std::array<bool, NumNode> Mask;
+    typedef Matrix<float, Dynamic, Dynamic, RowMajor> Batch;
+    typedef Matrix<float, 1, Dynamic> Bias;
+
+    // one node's step, features are rebuilt from (node, state) when it is sampled
+    struct Transition {
+        int node;
+        int state;
+        int action;
+        float reward;
+        int next_state;
+        bool done;
+    };
+
+    // relu(X * W1 + b1) * W2 + b2, Z and H are kept for backprop
+    struct Mlp {
+        Batch W1, W2;       // [NumFeature x dqn_hidden], [dqn_hidden x NumSlot]
+        Bias b1, b2;
+
+        void forward(const Batch& X, Batch& Z, Batch& H, Batch& Q) const {
+            Z.noalias() = X * W1;
+            Z.rowwise() += b1;
+            H = Z.cwiseMax(0.0f);
+            Q.noalias() = H * W2;
+            Q.rowwise() += b2;
+        }
+    };
+
+    void train_until(int max_iterations, double seconds) {
+        auto start = std::chrono::steady_clock::now();
+        std::ios::sync_with_stdio(false);
+        int i = 0;
+        while (i < max_iterations) {
+            replay.seed(get_seed());
+            run_iteration();
+            change_seed();
+            reset(true);
+            ++i;
+            if (seconds > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= seconds) {
+                break;
+            }
+        }
+        iterations = i;
+        calc_average();
+    }
+
+    void run_iteration() {
+        for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
+            run_episode();
+        }
+    }
+
+    void run_episode() {
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        observe(0, S_1());
+        choose_action(S_1(), A_1);
+
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            Reward reward = { 0.0 };
+            Mask active = { false };
+            check_collision(A_1, reward, active);
+            observe(frame_num + 1, S_2());
+            update(reward, active);
+            choose_action(S_2(), A_1);
+            render(frame_num);
+            current ^= 1;
+        }
+
+        bool is_complete = true;
+        for (auto& node : nodes) {
+            node.is_success ? ++success_node : is_complete = false;
+        }
+        is_complete ? ++total_success : ++total_failure;
+        TRACE_COUNTER(1, "total_success", total_success);
+        TRACE_COUNTER(1, "total_failure", total_failure);
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+
+        final_reward();
+        data.success_data[episode_num] += success_data;
+        data.success_node[episode_num] += success_node;
+        data.cum_reward[episode_num] += cur_reward;
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+        for (auto& node : nodes) {
+            node.reset();
+        }
+    }
+
+    void observe(unsigned int frame, State& state) const {
+        for (auto& node : nodes) {
+            state[node.node_num] = observe_state(node.last_outcome, node.remaining_data, frame);
+        }
+    }
+
+    // one-hot state and node number in row `row` of `F`
+    static void feature_row(Batch& F, int row, int node_num, int state) {
+        F.row(row).setZero();
+        F(row, state) = 1.0f;
+        F(row, NumState + node_num) = 1.0f;
+    }
+
+    // slot values of every node from one batched forward pass
+    void evaluate(const State& state) {
+        for (int nn = 0; nn < NumNode; nn++) {
+            feature_row(Phi, nn, nn, state[nn]);
+        }
+        online.forward(Phi, Z_act, H_act, Q_act);
+    }
+
+    void choose_action(const State& state, Action& action) {
+        PROFILE_SCOPE(Choose_Action);
+        evaluate(state);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (node.is_success) {
+                action[nn] = -1;
+                continue;
+            }
+            if (explore[episode_num] >= get_rand_real(0, 1)) {
+                action[nn] = get_rand_int(0, NumSlot - 1);
+            }
+            else {
+                int index;
+                Q_act.row(nn).maxCoeff(&index);
+                action[nn] = index;
+            }
+        }
+    }
+
+    void check_collision(const Action& action, Reward& reward, Mask& active) {
+        PROFILE_SCOPE(Collision);
+        double idle = rewards.idle(action);
+        for (auto& node : nodes) {
+            if (node.remaining_data != 0) {
+                auto nn = node.node_num;
+                active[nn] = true;
+                // collision X
+                bool success = std::count(action.begin(), action.end(), action[nn]) == 1;
+                if (success) {
+                    node.last_outcome = Outcome::Success;
+                    --node.remaining_data;
+                    ++success_data;
+                    ++success_frame;
+                    if (node.remaining_data == 0) {
+                        node.is_success = true;
+                    }
+                }
+                // collision O
+                else {
+                    node.last_outcome = Outcome::Collision;
+                }
+                reward[nn] = rewards.step(success, node.remaining_data) + idle;
+            }
+        }
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[frame_num_data++] += success_frame;
+        success_frame = 0;
+    }
+
+    // store the step of every active node, then one minibatch step
+    void update(const Reward& reward, const Mask& active) {
+        PROFILE_SCOPE(Update);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (!active[nn]) continue;
+            remember({ static_cast<int>(nn), S_1()[nn], A_1[nn], static_cast<float>(reward[nn]), S_2()[nn], node.is_success });
+            cur_reward += reward[nn];
+        }
+        learn();
+    }
+
+    // terminal transition at the greedy slot of the state every node ended in
+    void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        evaluate(S_1());
+        double bonus = rewards.episode_bonus(nodes);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            double reward = rewards.final(node.is_success, bonus);
+            int index;
+            Q_act.row(nn).maxCoeff(&index);
+            remember({ static_cast<int>(nn), S_1()[nn], index, static_cast<float>(reward), S_1()[nn], true });
+            cur_reward += reward;
+        }
+        learn();
+    }
+
+    void remember(const Transition& t) {
+        replay.push(0, t);
+    }
+
+    // Q-learning targets from the target network, squared error on the taken slots
+    void learn() {
+        if (replay.size(0) < dqn_batch) return;
+        const auto& batch = replay.sample(0, dqn_batch);
+        for (int i = 0; i < dqn_batch; i++) {
+            const auto& t = replay[batch[i].id];
+            feature_row(X, i, t.node, t.state);
+            feature_row(X_next, i, t.node, t.next_state);
+        }
+        target.forward(X_next, Z_next, H_next, Q_next);
+        online.forward(X, Z, H, Q);
+
+        // dL/dQ is only non-zero at the slot each transition took
+        dQ.setZero(dqn_batch, NumSlot);
+        for (int i = 0; i < dqn_batch; i++) {
+            const auto& t = replay[batch[i].id];
+            float y = t.reward;
+            if (!t.done) {
+                y += static_cast<float>(gamma) * Q_next.row(i).maxCoeff();
+            }
+            float error = Q(i, t.action) - y;
+            dQ(i, t.action) = batch[i].weight * error / dqn_batch;
+            replay.update_priority(batch[i].id, error);
+        }
+
+        dH.noalias() = dQ * online.W2.transpose();
+        dH = (Z.array() > 0.0f).select(dH, 0.0f);
+        online.W2.noalias() -= dqn_learning_rate * H.transpose() * dQ;
+        online.b2 -= dqn_learning_rate * dQ.colwise().sum();
+        online.W1.noalias() -= dqn_learning_rate * X.transpose() * dH;
+        online.b1 -= dqn_learning_rate * dH.colwise().sum();
+
+        if (++learn_steps % dqn_target_sync == 0) {
+            target = online;
+        }
+    }
+
+    void render(int step) {
+        TRACE_INSTANT(2, "frame", "step", step);
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "action", "node", node.node_num, "slot", A_1[node.node_num]);
+        }
+#endif
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        PROFILE_SCOPE(Calc_Average);
+        double count = iterations;
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [count](double& val) {val = val / count; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [count](double& val) {val = val / count; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [count](double& val) {val = val / count; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [count](double& val) {val = val / count; });
+    }
+
+    // He init for the hidden layer, small output weights and an optimistic output bias at the
+    // return of always succeeding, the same start the tabular learners get
+    void reset_net() {
+        online.W1 = Batch::Random(NumFeature, dqn_hidden) * std::sqrt(6.0f / NumFeature);
+        online.b1 = Bias::Zero(dqn_hidden);
+        online.W2 = Batch::Random(dqn_hidden, NumSlot) * 0.1f;
+        online.b2 = Bias::Constant(NumSlot, static_cast<float>(positive_feedback / (1 - gamma)));
+        target = online;
+        replay.clear();
+        learn_steps = 0;
+    }
+
+    void reset(bool iteration_end) {
+        for (auto& node : nodes) {
+            node.reset();
+        }
+        if (iteration_end) {
+            reset_net();
+        }
+        frame_num_data = 0;
+        cur_reward = 0;
+    }
+
+    std::string plot_str;
+
+    NodeArr nodes;
+    // states of the current and the next frame, a frame ends by flipping `current` instead of copying
+    // The action is chosen after the update, so one buffer written in place is enough.
+    std::array<State, 2> states;
+    int current = 0;
+    State& S_1() { return states[current]; }
+    State& S_2() { return states[current ^ 1]; }
+    Action A_1;
+    Plot_Data data;
+    Reward_Table rewards;
+
+    double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
+    double gamma = 0.6;
+    int iterations = iterations_target;
+
+    Mlp online, target;
+    Replay_Buffer<Transition> replay;
+    unsigned int learn_steps = 0;
+
+    Batch Phi, Z_act, H_act, Q_act;         // acting, every node [NumNode x ...]
+    Batch X, Z, H, Q, dQ, dH;               // minibatch through the online network [dqn_batch x ...]
+    Batch X_next, Z_next, H_next, Q_next;   // minibatch through the target network
+
+    int success_frame = 0;
+    int success_data = 0;
+    int success_node = 0;
+
+    unsigned int total_success = 0;
+    unsigned int total_failure = 0;
+    unsigned int frame_num = 0;
+    unsigned int frame_num_data = 0;
+    unsigned int episode_num = 0;
+
+    double cur_reward = 0;
+};
+
+// Tabular TD against DQN with the same wall-clock budget each
+// Prints how many iterations each learner fit in and how many nodes succeed over the last tenth of the episodes
+inline void compare_wall_clock(double seconds, double epsilon = 0.05, unsigned int seed = 1) {
+    auto late_success = [](const Plot_Data& data) {
+        int from = episode_num_target - episode_num_target / 10;
+        double sum = 0.0;
+        for (int ep = from; ep < episode_num_target; ep++) {
+            sum += data.success_node[ep];
+        }
+        return sum / (episode_num_target - from);
+    };
+
+    set_seed(seed);
+    std::srand(seed);
+    SlottedAlohaRL_TD<> td(epsilon);
+    td.train_for(seconds);
+
+    set_seed(seed);
+    std::srand(seed);
+    SlottedAlohaRL_DQN dqn(epsilon);
+    dqn.train_for(seconds);
+    // timings of these runs would otherwise end up in the next learner's profile
+    profile::registry().reset();
+
+    cout << "Equal wall clock, " << seconds << " s each\n"
+         << std::left << std::setw(12) << "learner" << std::right
+         << std::setw(12) << "iterations" << std::setw(16) << "late success" << "\n" << std::fixed
+         << std::left << std::setw(12) << "TD" << std::right
+         << std::setw(12) << td.get_policies().size() << std::setw(16) << std::setprecision(2) << late_success(td.get_data()) << "\n"
+         << std::left << std::setw(12) << "DQN" << std::right
+         << std::setw(12) << dqn.get_iterations() << std::setw(16) << std::setprecision(2) << late_success(dqn.get_data()) << "\n";
+    cout.flush();
+}
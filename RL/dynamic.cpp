@@ -0,0 +1,2 @@
+#include "dynamic.h"
+constexpr int SlottedAlohaRL_Dynamic::episode_slots;
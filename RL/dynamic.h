@@ -0,0 +1,360 @@
+#pragma once
+#include "include.h"
+
+// How the next frame's length is picked from the slots of the last one
+enum class Frame_Estimator {
+    Fixed,      // the first frame's length in every frame, NumSlot as in the other learners
+    Schoute,    // backlog = successes + 2.39 * collisions
+    Vogt,       // backlog whose expected idle, success and collision counts are closest to the observed ones
+    Exact,      // the true backlog, an upper bound for the estimators
+};
+
+inline std::string estimator_name(Frame_Estimator estimator) {
+    switch (estimator) {
+    case Frame_Estimator::Schoute: return "Schoute";
+    case Frame_Estimator::Vogt: return "Vogt";
+    case Frame_Estimator::Exact: return "exact";
+    default: return "fixed";
+    }
+}
+
+constexpr int vogt_max_backlog = 4 * dfsa_max_slots;
+
+// Backlog estimate of a frame and the length of the next one
+// A node keeps contending until its last data is through, so a success does not take it out of the
+// backlog as a read tag does in RFID, and the next frame gets a slot per estimated node.
+// Vogt's search uses a table of (1 - 1/L)^n, built once per learner.
+class Frame_Length {
+public:
+    explicit Frame_Length(Frame_Estimator estimator = Frame_Estimator::Vogt, int initial = NumSlot) :
+        estimator(estimator), initial(std::max(1, std::min(dfsa_max_slots, initial)))
+    {
+        if (estimator != Frame_Estimator::Vogt) return;
+        miss.resize((dfsa_max_slots + 1) * (vogt_max_backlog + 1));
+        for (int L = 1; L <= dfsa_max_slots; L++) {
+            for (int n = 0; n <= vogt_max_backlog; n++) {
+                miss[L * (vogt_max_backlog + 1) + n] = std::pow(1.0 - 1.0 / L, n);
+            }
+        }
+    }
+
+    // length of the first frame of an episode
+    int first() const {
+        return initial;
+    }
+    // frame of `length` slots had `idle`, `single` and `collided` slots, `backlog` nodes really have data
+    int next(int length, int idle, int single, int collided, int backlog) const {
+        double estimate;
+        switch (estimator) {
+        case Frame_Estimator::Fixed: return initial;
+        case Frame_Estimator::Exact: estimate = backlog; break;
+        case Frame_Estimator::Schoute: estimate = single + 2.39 * collided; break;
+        default: estimate = vogt(length, idle, single, collided); break;
+        }
+        return std::max(dfsa_min_slots, std::min(dfsa_max_slots, static_cast<int>(std::lround(estimate))));
+    }
+
+private:
+    // n in [single + 2 collided, 2 (single + 2 collided)] with the least squared error
+    int vogt(int length, int idle, int single, int collided) const {
+        int low = single + 2 * collided;
+        int high = std::min(vogt_max_backlog, 2 * low);
+        const double* p = miss.data() + length * (vogt_max_backlog + 1);
+        int best = low;
+        double best_error = std::numeric_limits<double>::max();
+        for (int n = std::max(low, 1); n <= high; n++) {
+            double a0 = length * p[n];
+            double a1 = n * p[n - 1];
+            double ak = length - a0 - a1;
+            double error = (a0 - idle) * (a0 - idle) + (a1 - single) * (a1 - single) + (ak - collided) * (ak - collided);
+            if (error < best_error) {
+                best_error = error;
+                best = n;
+            }
+        }
+        return best;
+    }
+
+    Frame_Estimator estimator;
+    int initial;
+    std::vector<double> miss;       // [L][n], (1 - 1/L)^n
+};
+
+// Dynamic frame slotted ALOHA: TD (SARSA) over frames whose length follows the estimated backlog
+// An episode is a budget of frame_num_target * NumSlot slots instead of a number of frames, so
+// results compare with the fixed-frame learners slot for slot, and its last frame is cut to what
+// is left of the budget. Per-step results are successes per NumSlot slots.
+// Q rows live in one arena allocated at dfsa_max_slots per node. A frame of L slots uses the
+// first L entries of every row, entries past it keep their values until the frame grows again,
+// so a length change costs nothing.
+// Idle slot shaping (see reward.h) is sized for NumSlot slots and does not apply here.
+class SlottedAlohaRL_Dynamic {
+public:
+    // `initial` is the length of every episode's first frame, and of every frame with Fixed
+    SlottedAlohaRL_Dynamic(Frame_Estimator estimator = Frame_Estimator::Vogt, int initial = NumSlot, const double& epsilon = 0.1,
+                           const double& alpha = 0.1, const double& gamma = 0.6) :
+        epsilon(epsilon), alpha(static_cast<float>(alpha)), gamma(static_cast<float>(gamma)),
+        frame_length(estimator, initial), Q(NumNode * dfsa_max_slots)
+    {
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(2) << epsilon;
+        plot_str = "DFSA TD(" + estimator_name(estimator) + ", L=" + std::to_string(frame_length.first())
+                   + ", e=" + stream.str() + ")";
+        int i = 0;
+        for (auto& node : nodes) {
+            node.node_num = i++;
+        }
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    void train() {
+        std::ios::sync_with_stdio(false);
+        set_seed(get_seed());
+        for (int i = 0; i < iterations; i++) {
+            reset_Q();
+            run_iteration();
+            change_seed();
+            reset();
+        }
+        calc_average();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+    // slots per frame over every frame trained so far
+    double mean_length() const {
+        return frames ? static_cast<double>(slots) / frames : 0.0;
+    }
+
+private:
+    struct Node {
+        friend class SlottedAlohaRL_Dynamic;
+    public:
+        unsigned int node_num;
+        unsigned int remaining_data = data_target;
+        bool is_success = false;
+
+        void reset() {
+            remaining_data = data_target;
+            is_success = false;
+        }
+    };
+
+    typedef std::array<int, NumNode> Action;
+    typedef std::array<Node, NumNode> NodeArr;
+    typedef std::array<double, NumNode> Reward;
+
+    static constexpr int episode_slots = frame_num_target * NumSlot;
+
+    float* row(int node_num) {
+        return Q.data() + node_num * dfsa_max_slots;
+    }
+
+    void run_iteration() {
+        for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
+            run_episode();
+        }
+    }
+
+    void run_episode() {
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        int used = 0;
+        int length = std::min(frame_length.first(), episode_slots);
+        choose_action(A_1(), length);
+        while (used < episode_slots) {
+            Reward reward = { 0.0 };
+            int idle, single, collided;
+            check_collision(length, reward, idle, single, collided);
+            record_frame(used);
+            used += length;
+            ++frames;
+            slots += length;
+
+            int backlog = 0;
+            for (auto& node : nodes) {
+                if (node.remaining_data != 0) ++backlog;
+            }
+            int next = std::min(frame_length.next(length, idle, single, collided, backlog), episode_slots - used);
+            TRACE_COUNTER(2, "frame_length", next);
+            if (next > 0) {
+                choose_action(A_2(), next);
+            }
+            else {
+                A_2().fill(-1);
+            }
+            update(reward);
+            current ^= 1;
+            length = next;
+        }
+
+        bool is_complete = true;
+        for (auto& node : nodes) {
+            node.is_success ? ++success_node : is_complete = false;
+        }
+        is_complete ? ++total_success : ++total_failure;
+        TRACE_COUNTER(1, "total_success", total_success);
+        TRACE_COUNTER(1, "total_failure", total_failure);
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+
+        final_reward();
+        data.success_data[episode_num] += success_data;
+        data.success_node[episode_num] += success_node;
+        data.cum_reward[episode_num] += cur_reward;
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+        for (auto& node : nodes) {
+            node.reset();
+        }
+    }
+
+    // a slot in [0, length) for every node with data, -1 for the others
+    void choose_action(Action& action, int length) {
+        PROFILE_SCOPE(Choose_Action);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (node.remaining_data == 0) {
+                action[nn] = -1;
+            }
+            else if (explore[episode_num] >= get_rand_real(0, 1)) {
+                action[nn] = get_rand_int(0, length - 1);
+            }
+            else {
+                const float* q = row(nn);
+                action[nn] = static_cast<int>(std::max_element(q, q + length) - q);
+            }
+        }
+    }
+
+    // occupancy of the frame's slots, the rewards of the nodes that sent and the slot counts the
+    // estimators see
+    void check_collision(int length, Reward& reward, int& idle, int& single, int& collided) {
+        PROFILE_SCOPE(Collision);
+        std::fill(occupancy.begin(), occupancy.begin() + length, 0);
+        for (auto slot : A_1()) {
+            if (slot >= 0) ++occupancy[slot];
+        }
+        idle = single = collided = 0;
+        for (int s = 0; s < length; s++) {
+            occupancy[s] == 0 ? ++idle : occupancy[s] == 1 ? ++single : ++collided;
+        }
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (A_1()[nn] < 0) continue;
+            bool success = occupancy[A_1()[nn]] == 1;
+            if (success) {
+                --node.remaining_data;
+                ++success_data;
+                ++success_frame;
+                if (node.remaining_data == 0) {
+                    node.is_success = true;
+                }
+            }
+            reward[nn] = rewards.step(success, node.remaining_data);
+        }
+    }
+
+    // SARSA on A_1 -> A_2 for the nodes that sent
+    void update(const Reward& reward) {
+        PROFILE_SCOPE(Update);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (A_1()[nn] < 0) continue;
+            float* q = row(nn);
+            float next = A_2()[nn] >= 0 ? q[A_2()[nn]] : 0.0f;
+            float target = static_cast<float>(reward[nn]) + gamma * next;
+            q[A_1()[nn]] += alpha * (target - q[A_1()[nn]]);
+            cur_reward += reward[nn];
+        }
+    }
+
+    // terminal reward at the greedy slot of a NumSlot frame
+    void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        double bonus = rewards.episode_bonus(nodes);
+        for (auto& node : nodes) {
+            float* q = row(node.node_num);
+            double reward = rewards.final(node.is_success, bonus);
+            *std::max_element(q, q + NumSlot) += static_cast<float>(reward);
+            cur_reward += reward;
+        }
+    }
+
+    // successes of the frame go to the NumSlot-slot step it starts in
+    void record_frame(int used) {
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[episode_num * frame_num_target + used / NumSlot] += success_frame;
+        success_frame = 0;
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
+    }
+
+    // uniform in [-1, 1] as the other learners start their Q rows
+    void reset_Q() {
+        for (auto& q : Q) {
+            q = static_cast<float>(get_rand_real(-1, 1));
+        }
+    }
+
+    void reset() {
+        for (auto& node : nodes) {
+            node.reset();
+        }
+        cur_reward = 0;
+    }
+
+    std::string plot_str;
+
+    NodeArr nodes;
+    // actions of the current and the next frame, a frame ends by flipping `current` instead of copying
+    std::array<Action, 2> actions;
+    int current = 0;
+    Action& A_1() { return actions[current]; }
+    Action& A_2() { return actions[current ^ 1]; }
+    Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+
+    double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
+    float alpha = 0.1f;
+    float gamma = 0.6f;
+
+    Frame_Length frame_length;
+    std::vector<float> Q;                       // [NumNode x dfsa_max_slots] arena
+    std::array<int, dfsa_max_slots> occupancy;
+
+    int success_frame = 0;
+    int success_data = 0;
+    int success_node = 0;
+
+    unsigned long long frames = 0;
+    unsigned long long slots = 0;
+
+    unsigned int total_success = 0;
+    unsigned int total_failure = 0;
+    unsigned int episode_num = 0;
+
+    double cur_reward = 0;
+};
@@ -0,0 +1,201 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+#include "global.h"
+
+// Experience replay for the off-policy learners
+//
+// A Replay_Buffer holds `rings` fixed-capacity ring buffers, one per node or a single shared one.
+// Items of every ring live in one arena of rings * capacity entries that is allocated by init(),
+// so pushing and sampling never allocate. Sampling is uniform or prioritized by TD error, with
+// a sum tree per ring for O(log capacity) draws and priority updates.
+
+enum class Sampling {
+    Uniform,
+    Prioritized
+};
+
+// Binary tree over `leaves` priorities (a power of two), every inner entry is the sum of its children
+// tree[1] is the root, the priority of leaf i sits at tree[leaves + i]
+class Sum_Tree {
+public:
+    Sum_Tree(double* tree, int leaves) : tree(tree), leaves(leaves) {}
+
+    double total() const {
+        return tree[1];
+    }
+    double get(int i) const {
+        return tree[leaves + i];
+    }
+    void set(int i, double priority) {
+        int n = leaves + i;
+        tree[n] = priority;
+        for (n >>= 1; n >= 1; n >>= 1) {
+            tree[n] = tree[2 * n] + tree[2 * n + 1];
+        }
+    }
+    // leaf whose prefix sum range holds `mass`, empty right subtrees are never entered
+    int find(double mass) const {
+        int n = 1;
+        while (n < leaves) {
+            if (mass < tree[2 * n] || tree[2 * n + 1] <= 0) {
+                n = 2 * n;
+            }
+            else {
+                mass -= tree[2 * n];
+                n = 2 * n + 1;
+            }
+        }
+        return n - leaves;
+    }
+
+private:
+    double* tree;
+    int leaves;
+};
+
+struct Replay_Sample {
+    int id;             // item id for operator[] and update_priority()
+    float weight;       // importance-sampling weight, 1 for uniform sampling
+};
+
+template <typename T>
+class Replay_Buffer {
+public:
+    Replay_Buffer() = default;
+    Replay_Buffer(int rings, int capacity, Sampling sampling = Sampling::Uniform) {
+        init(rings, capacity, sampling);
+    }
+
+    void init(int rings, int capacity, Sampling sampling = Sampling::Uniform) {
+        this->rings = rings;
+        this->capacity = capacity;
+        this->mode = sampling;
+        leaves = 1;
+        while (leaves < capacity) leaves <<= 1;
+        items.assign(static_cast<size_t>(rings) * capacity, T());
+        tree.assign(mode == Sampling::Prioritized ? static_cast<size_t>(rings) * 2 * leaves : 0, 0.0);
+        heads.assign(rings, 0);
+        sizes.assign(rings, 0);
+        batch.clear();
+        max_priority = 1.0;
+    }
+    // forget every item, the arena is kept
+    void clear() {
+        std::fill(heads.begin(), heads.end(), 0);
+        std::fill(sizes.begin(), sizes.end(), 0);
+        std::fill(tree.begin(), tree.end(), 0.0);
+        max_priority = 1.0;
+    }
+    void seed(unsigned int seed) {
+        rng.seed(seed);
+    }
+
+    Sampling sampling() const {
+        return mode;
+    }
+    int size(int ring) const {
+        return sizes[ring];
+    }
+    int size() const {
+        int total = 0;
+        for (auto s : sizes) total += s;
+        return total;
+    }
+    T& operator[](int id) {
+        return items[id];
+    }
+    const T& operator[](int id) const {
+        return items[id];
+    }
+
+    // overwrite the oldest item of `ring` once it is full, new items get the highest priority seen so far
+    int push(int ring, const T& item) {
+        int slot = heads[ring];
+        heads[ring] = (slot + 1) % capacity;
+        sizes[ring] = std::min(sizes[ring] + 1, capacity);
+        int id = ring * capacity + slot;
+        items[id] = item;
+        if (mode == Sampling::Prioritized) {
+            ring_tree(ring).set(slot, max_priority);
+        }
+        return id;
+    }
+
+    // `count` draws with replacement from `ring`, or from all rings when `ring` is -1, which must hold an item
+    // The returned batch is reused by the next call
+    const std::vector<Replay_Sample>& sample(int ring, int count) {
+        batch.resize(count);
+        if (mode == Sampling::Uniform) {
+            int total = ring < 0 ? size() : sizes[ring];
+            std::uniform_int_distribution<int> pick(0, std::max(0, total - 1));
+            for (auto& s : batch) {
+                s.id = ring < 0 ? uniform_id(pick(rng)) : ring * capacity + pick(rng);
+                s.weight = 1.0f;
+            }
+            return batch;
+        }
+
+        // stratified: one draw from each of `count` equal slices of the priority mass
+        double total = 0.0;
+        int stored = 0;
+        for (int r = (ring < 0 ? 0 : ring); r < (ring < 0 ? rings : ring + 1); r++) {
+            total += ring_tree(r).total();
+            stored += sizes[r];
+        }
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        float max_weight = 0.0f;
+        for (int i = 0; i < count; i++) {
+            double mass = (i + unit(rng)) * total / count;
+            int r = ring;
+            if (r < 0) {
+                for (r = 0; r < rings - 1 && mass >= ring_tree(r).total(); r++) {
+                    mass -= ring_tree(r).total();
+                }
+            }
+            auto ring_sum = ring_tree(r);
+            int slot = std::min(ring_sum.find(mass), sizes[r] - 1);
+            double p = ring_sum.get(slot) / total;
+            batch[i].id = r * capacity + slot;
+            batch[i].weight = static_cast<float>(std::pow(stored * p, -replay_priority_beta));
+            max_weight = std::max(max_weight, batch[i].weight);
+        }
+        for (auto& s : batch) {
+            s.weight /= max_weight;
+        }
+        return batch;
+    }
+
+    void update_priority(int id, double td_error) {
+        if (mode != Sampling::Prioritized) return;
+        double priority = std::pow(std::abs(td_error) + replay_priority_eps, replay_priority_alpha);
+        max_priority = std::max(max_priority, priority);
+        ring_tree(id / capacity).set(id % capacity, priority);
+    }
+
+private:
+    Sum_Tree ring_tree(int ring) {
+        return Sum_Tree(tree.data() + static_cast<size_t>(ring) * 2 * leaves, leaves);
+    }
+    // n-th stored item counting ring by ring
+    int uniform_id(int n) const {
+        int r = 0;
+        while (n >= sizes[r]) n -= sizes[r++];
+        return r * capacity + n;
+    }
+
+    int rings = 0;
+    int capacity = 0;
+    int leaves = 1;
+    Sampling mode = Sampling::Uniform;
+
+    std::vector<T> items;                   // ring r owns [r * capacity, (r + 1) * capacity)
+    std::vector<double> tree;               // sum tree of ring r at r * 2 * leaves
+    std::vector<int> heads, sizes;
+    std::vector<Replay_Sample> batch;
+    double max_priority = 1.0;
+    std::minstd_rand rng;                   // own engine so replay does not shift the simulation's draws
+};
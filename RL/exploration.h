@@ -0,0 +1,176 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#include <Eigen/Dense>
+
+#include "global.h"
+
+// Exploration schedules
+// A schedule is the exploration strength of every episode, computed once per learner into a table.
+// It is the random action probability for epsilon-greedy, the temperature for softmax and the bonus
+// weight for UCB. Episode 0 explores at full strength 1, every schedule starts from `start` after that.
+enum class Schedule {
+    Harmonic,       // start / episode, the original schedule
+    Linear,         // start down to explore_floor over explore_decay_episodes
+    Exponential,    // start * explore_decay^episode, at least explore_floor
+    Constant,       // start in every episode
+};
+
+// How a node picks its slot from its Q row
+enum class Exploration {
+    Epsilon_Greedy,     // a random slot with the scheduled probability
+    Softmax,            // Boltzmann over the Q row at the scheduled temperature
+    UCB,                // greedy on Q + c * sqrt(ln t / n), c from the schedule
+    Optimistic,         // greedy, Q rows start at the return of succeeding every frame
+};
+
+inline std::string exploration_name(Exploration policy) {
+    switch (policy) {
+    case Exploration::Softmax: return "softmax";
+    case Exploration::UCB: return "UCB";
+    case Exploration::Optimistic: return "optimistic";
+    default: return "e-greedy";
+    }
+}
+
+class Exploration_Schedule {
+public:
+    Exploration_Schedule(double start = 0.1, Schedule schedule = Schedule::Harmonic) :
+        start(start), schedule(schedule), table(episode_num_target)
+    {
+        for (int episode = 0; episode < episode_num_target; episode++) {
+            table[episode] = value(episode);
+        }
+    }
+    // streaming runs go past the table and compute their strength
+    double operator[](unsigned int episode) const {
+        return episode < table.size() ? table[episode] : value(episode);
+    }
+
+private:
+    double value(unsigned int episode) const {
+        if (episode == 0) return 1.0;
+        switch (schedule) {
+        case Schedule::Linear: {
+            double done = std::min(1.0, static_cast<double>(episode) / explore_decay_episodes);
+            return start + (std::min(start, explore_floor) - start) * done;
+        }
+        case Schedule::Exponential:
+            return std::max(std::min(start, explore_floor), start * std::pow(explore_decay, episode));
+        case Schedule::Constant:
+            return start;
+        default:
+            return start / episode;
+        }
+    }
+
+    double start;
+    Schedule schedule;
+    std::vector<double> table;
+};
+
+// e^x for an Eigen array of x <= 0, from the exponent bits of 2^(x log2 e) and a cubic for its fraction
+// Relative error below 1.2e-4. Inputs are clamped to [-87, 0], below that the result is ~1e-38.
+// Every step is an array expression, so Eigen evaluates it a SIMD packet at a time.
+template <int Rows, int Cols>
+Eigen::Array<float, Rows, Cols> fast_exp(const Eigen::Array<float, Rows, Cols>& x) {
+    Eigen::Array<float, Rows, Cols> t = x.max(-87.0f).min(0.0f) * 1.44269504f;
+    Eigen::Array<int32_t, Rows, Cols> whole = t.template cast<int32_t>() - 1;     // t - whole in (0, 1]
+    Eigen::Array<float, Rows, Cols> f = t - whole.template cast<float>();
+    Eigen::Array<float, Rows, Cols> p = 1.0f + f * (0.695502f + f * (0.226270f + f * 0.078228f));
+    // adding to the exponent field scales by 2^whole
+    Eigen::Array<int32_t, Rows, Cols> bits;
+    std::memcpy(bits.data(), p.data(), sizeof(float) * p.size());
+    bits += whole.template shift_left<23>();
+    std::memcpy(p.data(), bits.data(), sizeof(float) * p.size());
+    return p;
+}
+
+// ln x for an Eigen array of x > 0 from its exponent bits and a polynomial in its mantissa m in [1, 2)
+// Absolute error below 4e-5, enough to draw samples from (see bandit.h).
+template <int Rows, int Cols>
+Eigen::Array<float, Rows, Cols> fast_log(const Eigen::Array<float, Rows, Cols>& x) {
+    Eigen::Array<int32_t, Rows, Cols> bits;
+    std::memcpy(bits.data(), x.data(), sizeof(float) * x.size());
+    Eigen::Array<float, Rows, Cols> exponent = (bits.template shift_right<23>() - 127).template cast<float>();
+    // keep the mantissa and set the exponent of 1
+    bits = (bits - (bits.template shift_right<23>().template shift_left<23>())) + (127 << 23);
+    Eigen::Array<float, Rows, Cols> m;
+    std::memcpy(m.data(), bits.data(), sizeof(float) * x.size());
+    Eigen::Array<float, Rows, Cols> f = m - 1.0f;
+    Eigen::Array<float, Rows, Cols> log2 = f * (1.442604f + f * (-0.7167147f + f * (0.440599f + f * (-0.225103f + f * 0.05866494f))));
+    return (exponent + log2) * 0.69314718f;
+}
+
+// Boltzmann slots of up to `Rows` nodes at once
+// Q rows are stored column-major, so every slot is one contiguous column across nodes and each
+// step runs over all nodes together: row maxima, scaled exponentials, a prefix sum over the slot
+// columns and the inverse CDF. The inverse CDF counts the prefix sums below u * total instead of
+// searching, so nothing branches on the data. Every node needs one uniform draw.
+template <int Rows>
+class Softmax_Batch {
+public:
+    typedef Eigen::Array<float, Rows, NumSlot> Block;
+
+    // Q row and uniform draw in [0, 1) of row `r`, rows that are not set keep their last values
+    template <typename Row>
+    void set(int r, const Row& row, double draw) {
+        q.row(r) = row.template cast<float>().array();
+        u(r) = static_cast<float>(draw);
+    }
+    void run(double temperature) {
+        float inv = static_cast<float>(1.0 / std::max(temperature, 1e-6));
+        Eigen::Array<float, Rows, 1> top = q.col(0);
+        for (int s = 1; s < NumSlot; s++) {
+            top = top.max(q.col(s));
+        }
+        Block cdf = fast_exp<Rows, NumSlot>((q.colwise() - top) * inv);
+        for (int s = 1; s < NumSlot; s++) {
+            cdf.col(s) += cdf.col(s - 1);
+        }
+        Eigen::Array<float, Rows, 1> pick = u * cdf.col(NumSlot - 1);
+        Eigen::Array<int, Rows, 1> below = Eigen::Array<int, Rows, 1>::Zero();
+        for (int s = 0; s < NumSlot; s++) {
+            below += (cdf.col(s) <= pick).template cast<int>();
+        }
+        slots = below.min(NumSlot - 1);
+    }
+    int slot(int r) const {
+        return slots(r);
+    }
+
+private:
+    Block q = Block::Zero();
+    Eigen::Array<float, Rows, 1> u = Eigen::Array<float, Rows, 1>::Zero();
+    Eigen::Array<int, Rows, 1> slots;
+};
+
+constexpr int ucb_table_size = frame_num_target * episode_num_target + 1;
+
+// UCB1 bonus sqrt(ln t / n) from tables of sqrt(ln t) and 1 / sqrt(n)
+// Untried slots get a large finite bonus, so they come first and Q still orders them
+class Ucb_Bonus {
+public:
+    Ucb_Bonus() : root_log(ucb_table_size), inv_root(ucb_table_size) {
+        for (int i = 1; i < ucb_table_size; i++) {
+            root_log[i] = std::sqrt(std::log(static_cast<double>(i)));
+            inv_root[i] = 1.0 / std::sqrt(static_cast<double>(i));
+        }
+    }
+    double operator()(uint32_t t, uint32_t n) const {
+        if (n == 0) return 1e6;
+        double a = t < ucb_table_size ? root_log[t] : std::sqrt(std::log(static_cast<double>(t)));
+        double b = n < ucb_table_size ? inv_root[n] : 1.0 / std::sqrt(static_cast<double>(n));
+        return a * b;
+    }
+
+private:
+    std::vector<double> root_log;
+    std::vector<double> inv_root;
+};
@@ -5,11 +5,27 @@
 constexpr int NumNode = 10;
 constexpr int NumSlot = 10;
 
-// rewards
-constexpr double positive_feedback = 1.0;
-constexpr double negative_feedback = 0.0;
-constexpr double episode_success = 10.0;
-constexpr double episode_failure = 0.0;
+// rewards, an experiment config can replace the defaults at startup (see config.h)
+struct Reward_Constants {
+    double positive_feedback = 1.0;
+    double negative_feedback = 0.0;
+    double episode_success = 10.0;
+    double episode_failure = 0.0;
+
+    // shaping (see reward.h), all off by default
+    double collision_penalty = 0.0;     // subtracted from negative_feedback on a collision
+    double idle_penalty = 0.0;          // per idle slot of the frame, for every node that still has data
+    double delay_penalty = 0.0;         // per frame a node still holds its full backlog, scaled by the backlog
+    double fairness_bonus = 0.0;        // times Jain's index of the data every node delivered, at episode end
+};
+inline Reward_Constants& reward_constants() {
+    static Reward_Constants rewards;
+    return rewards;
+}
+static const double& positive_feedback = reward_constants().positive_feedback;
+static const double& negative_feedback = reward_constants().negative_feedback;
+static const double& episode_success = reward_constants().episode_success;
+static const double& episode_failure = reward_constants().episode_failure;
 
 constexpr int frame_num_target = 10;
 constexpr int episode_num_target = 150;
@@ -18,6 +34,66 @@ constexpr int episode_num_target = 150;
 constexpr int iterations_target = 40;
 constexpr int data_target = 10;
 
+// long-horizon streaming mode (see stream.h)
+constexpr int stream_window = 1000;         // episodes averaged by the rolling mean
+constexpr int stream_trace_size = 512;      // points kept by decimated traces
+constexpr int stream_reservoir_size = 256;  // points kept by reservoir samples
+
+// observation of stateful learners (see stateful.h)
+// every extra bucket or phase multiplies the states a node has to learn,
+// so finer observations need longer runs than episode_num_target to pay off
+constexpr int backlog_buckets = 1;          // remaining data split into this many buckets
+constexpr int frame_phases = 1;             // frames of an episode split into this many phases
+
+// Exploration schedules (see exploration.h)
+constexpr double explore_floor = 0.01;      // lowest strength of the linear and exponential schedules
+constexpr double explore_decay = 0.97;      // per episode factor of the exponential schedule
+constexpr int explore_decay_episodes = 100; // episodes the linear schedule takes to reach the floor
+
+// Experience replay (see experience.h)
+constexpr int td_replay_capacity = 64;          // transitions kept per node by the TD learner
+constexpr double replay_priority_alpha = 0.6;   // how strongly the TD error skews sampling, 0 is uniform
+constexpr double replay_priority_beta = 0.4;    // importance-sampling correction, 1 removes the bias fully
+constexpr double replay_priority_eps = 0.01;    // keeps transitions without error sampleable
+
+// DQN learner (see dqn.h)
+constexpr int dqn_hidden = 32;              // units of the hidden layer
+constexpr int dqn_batch = 32;               // transitions per gradient step
+constexpr int dqn_replay_capacity = 4096;   // transitions kept for replay
+constexpr int dqn_target_sync = 100;        // gradient steps between target network copies
+constexpr float dqn_learning_rate = 0.1f;
+
+// Parameter-sharing learner (see shared.h)
+constexpr int shared_id_buckets = 16;       // node id rows, nodes beyond this many share rows
+constexpr int shared_shards = 2;            // groups of nodes with their own gradient buffer
+constexpr int shared_merge_frames = 5;      // frames between merges of the buffers into the table
+
+// Multi-threaded learner (see parallel.h)
+constexpr int parallel_nodes = 100000;      // nodes of the single large network
+constexpr int parallel_threads = 0;         // worker threads, 0 for one per hardware thread
+
+// Dynamic frame slotted ALOHA (see dynamic.h)
+constexpr int dfsa_min_slots = 2;           // shortest frame an estimator may ask for
+constexpr int dfsa_max_slots = 4 * NumSlot; // longest frame, every node's Q row is allocated at this length
+
+// Node churn (see churn.h)
+constexpr int churn_capacity = 4 * NumNode;         // pool size, the most nodes alive at once
+constexpr double churn_arrival_rate = 0.1;          // mean nodes joining after a frame
+constexpr double churn_departure_prob = 0.01;       // chance of every node to leave after a frame
+
+// Batched environments (see batch.h)
+constexpr int batch_networks = 16;         // networks simulated in lockstep, Q holds batch * NumNode * NumSlot floats
+
+// Sweeps (see scheduler.h)
+constexpr int sweep_tasks_per_thread = 4;   // iterations are chunked into about this many tasks per worker
+
+// Result cache (see cache.h)
+// Bump the version with every change to what a learner computes for the same parameters: its updates,
+// rewards, exploration, random draws or what it records. Parameters, sizes and reward constants are part
+// of every key already. Entries of older versions are never read again.
+constexpr int result_cache_version = 2;
+constexpr char result_cache_dir[] = "results";
+
 struct Plot_Data {
     Plot_Data() :   success_frame(frame_num_target * episode_num_target, 0), success_data(episode_num_target, 0), success_node(episode_num_target, 0),
                     cum_reward(episode_num_target, 0), episodes(episode_num_target), steps(frame_num_target * episode_num_target)
@@ -8,12 +8,17 @@
 #include <limits>
 #include <iomanip>
 #include <sstream>
+#include <chrono>
 
 #include <Eigen/Dense>
 #include "matplotlibcpp.h"
 
 #include "z_random.h"
 #include "global.h"
+#include "trace.h"
+#include "profile.h"
+#include "reward.h"
+#include "exploration.h"
 
 using namespace Eigen;
 namespace plt = matplotlibcpp;
@@ -0,0 +1,208 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <cstdlib>
+
+// Minimal JSON reader for experiment configs (see config.h)
+// Objects keep their key order. Errors are thrown as std::runtime_error with the line and column.
+class Json {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    static Json parse(const std::string& text);
+
+    Type type() const { return kind; }
+    bool is_null() const { return kind == Type::Null; }
+    bool is_bool() const { return kind == Type::Bool; }
+    bool is_number() const { return kind == Type::Number; }
+    bool is_string() const { return kind == Type::String; }
+    bool is_array() const { return kind == Type::Array; }
+    bool is_object() const { return kind == Type::Object; }
+
+    bool boolean() const { return flag; }
+    double number() const { return value; }
+    const std::string& string() const { return text; }
+    const std::vector<Json>& array() const { return items; }
+    const std::vector<std::pair<std::string, Json>>& object() const { return members; }
+
+    // member `key` of an object, nullptr if there is none
+    const Json* find(const std::string& key) const {
+        for (auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+
+    static const char* type_name(Type type) {
+        static const char* const names[] = { "null", "a boolean", "a number", "a string", "an array", "an object" };
+        return names[static_cast<int>(type)];
+    }
+
+private:
+    friend class Json_Parser;
+
+    Type kind = Type::Null;
+    bool flag = false;
+    double value = 0.0;
+    std::string text;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+};
+
+class Json_Parser {
+public:
+    explicit Json_Parser(const std::string& text) : src(text) {}
+
+    Json document() {
+        Json doc = parse_value();
+        skip_space();
+        if (pos != src.size()) fail("unexpected text after the document");
+        return doc;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what) const {
+        int line = 1, column = 1;
+        for (size_t i = 0; i < pos && i < src.size(); i++) {
+            if (src[i] == '\n') {
+                ++line;
+                column = 1;
+            }
+            else {
+                ++column;
+            }
+        }
+        throw std::runtime_error("json " + std::to_string(line) + ":" + std::to_string(column) + ": " + what);
+    }
+
+    // whitespace and // line comments, which configs tend to want
+    void skip_space() {
+        while (pos < src.size()) {
+            char c = src[pos];
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                ++pos;
+            }
+            else if (c == '/' && pos + 1 < src.size() && src[pos + 1] == '/') {
+                while (pos < src.size() && src[pos] != '\n') ++pos;
+            }
+            else {
+                break;
+            }
+        }
+    }
+    bool take(char c) {
+        skip_space();
+        if (pos < src.size() && src[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+    void expect(char c) {
+        if (!take(c)) fail(std::string("expected '") + c + "'");
+    }
+    bool word(const char* w) {
+        size_t n = std::char_traits<char>::length(w);
+        if (src.compare(pos, n, w) == 0) {
+            pos += n;
+            return true;
+        }
+        return false;
+    }
+
+    Json parse_value() {
+        skip_space();
+        if (pos >= src.size()) fail("unexpected end of input");
+        Json val;
+        char c = src[pos];
+        if (c == '{') {
+            ++pos;
+            val.kind = Json::Type::Object;
+            if (take('}')) return val;
+            do {
+                skip_space();
+                if (pos >= src.size() || src[pos] != '"') fail("expected a key");
+                std::string key = parse_string();
+                if (val.find(key)) fail("duplicate key \"" + key + "\"");
+                expect(':');
+                val.members.emplace_back(key, parse_value());
+            } while (take(','));
+            expect('}');
+        }
+        else if (c == '[') {
+            ++pos;
+            val.kind = Json::Type::Array;
+            if (take(']')) return val;
+            do {
+                val.items.push_back(parse_value());
+            } while (take(','));
+            expect(']');
+        }
+        else if (c == '"') {
+            val.kind = Json::Type::String;
+            val.text = parse_string();
+        }
+        else if (word("true")) {
+            val.kind = Json::Type::Bool;
+            val.flag = true;
+        }
+        else if (word("false")) {
+            val.kind = Json::Type::Bool;
+        }
+        else if (word("null")) {
+            val.kind = Json::Type::Null;
+        }
+        else {
+            const char* begin = src.c_str() + pos;
+            char* end = nullptr;
+            val.value = std::strtod(begin, &end);
+            if (end == begin) fail("unexpected character");
+            pos += end - begin;
+            val.kind = Json::Type::Number;
+        }
+        return val;
+    }
+
+    // ASCII escapes only, \u escapes are kept below 0x80
+    std::string parse_string() {
+        ++pos;
+        std::string out;
+        while (pos < src.size() && src[pos] != '"') {
+            char c = src[pos++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= src.size()) break;
+            char e = src[pos++];
+            switch (e) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                if (pos + 4 > src.size()) fail("bad \\u escape");
+                long code = std::strtol(src.substr(pos, 4).c_str(), nullptr, 16);
+                if (code >= 0x80) fail("only ASCII \\u escapes are supported");
+                out += static_cast<char>(code);
+                pos += 4;
+                break;
+            }
+            default: out += e; break;
+            }
+        }
+        if (pos >= src.size()) fail("unterminated string");
+        ++pos;
+        return out;
+    }
+
+    const std::string& src;
+    size_t pos = 0;
+};
+
+inline Json Json::parse(const std::string& text) {
+    return Json_Parser(text).document();
+}
@@ -0,0 +1,2 @@
+#include "linear.h"
+constexpr int SlottedAlohaRL_Linear::NumFeature;
\ No newline at end of file
@@ -0,0 +1,288 @@
+#pragma once
+#include "include.h"
+#include "observation.h"
+
+// Semi-gradient SARSA with a linear Q function
+// A node's features are the one-hot of its observed state and the one-hot of its node number,
+// so Q(node, state, slot) = W(state, slot) + W(NumState + node, slot).
+// Rows of all nodes are stacked into Phi [NumNode x NumFeature], which turns feature
+// evaluation into Q = Phi * W and the gradient step into W += alpha * Phi^T * D,
+// where D holds the TD error of every node at the slot it chose.
+class SlottedAlohaRL_Linear {
+public:
+    static constexpr int NumFeature = NumState + NumNode;
+
+    SlottedAlohaRL_Linear(const double& epsilon = 0.1, const double& alpha = 0.1, const double& gamma = 0.6) :
+        epsilon(epsilon), alpha(alpha), gamma(gamma), Phi_1(NumNode, NumFeature), Phi_2(NumNode, NumFeature),
+        Q_1(NumNode, NumSlot), Q_2(NumNode, NumSlot), D(NumNode, NumSlot)
+    {
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(2) << epsilon;
+        plot_str = "Linear TD(e=" + stream.str() + ")";
+        int i = 0;
+        for (auto& node : nodes) {
+            node.node_num = i++;
+        }
+        reset_W();
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    void train() {
+        std::ios::sync_with_stdio(false);
+        for (int i = 0; i < iterations; i++) {
+            run_iteration();
+            change_seed();
+            reset(true);
+        }
+        calc_average();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+
+private:
+    struct Node {
+        friend class SlottedAlohaRL_Linear;
+    public:
+        unsigned int node_num;
+        unsigned int remaining_data = data_target;
+        bool is_success = false;
+        Outcome last_outcome = Outcome::Idle;
+
+        void reset() {
+            remaining_data = data_target;
+            is_success = false;
+            last_outcome = Outcome::Idle;
+        }
+    };
+
+    typedef std::array<int, NumNode> Action;
+    typedef std::array<Node, NumNode> NodeArr;
+    typedef std::array<double, NumNode> Reward;
+    typedef std::array<bool, NumNode> Mask;
+    typedef Matrix<double, Dynamic, Dynamic, RowMajor> Batch;
+
+    void run_iteration() {
+        for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
+            run_episode();
+        }
+    }
+
+    void run_episode() {
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        features(0, Phi_1);
+        Q_1.noalias() = Phi_1 * W;
+        choose_action(Q_1, A_1());
+
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            Reward reward = { 0.0 };
+            Mask active = { false };
+            check_collision(A_1(), reward, active);
+            features(frame_num + 1, Phi_2);
+            Q_2.noalias() = Phi_2 * W;
+            choose_action(Q_2, A_2());
+            update(reward, active);
+            render(frame_num);
+            Phi_1.swap(Phi_2);
+            Q_1.swap(Q_2);
+            current ^= 1;
+        }
+
+        bool is_complete = true;
+        for (auto& node : nodes) {
+            node.is_success ? ++success_node : is_complete = false;
+        }
+        is_complete ? ++total_success : ++total_failure;
+        TRACE_COUNTER(1, "total_success", total_success);
+        TRACE_COUNTER(1, "total_failure", total_failure);
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+
+        final_reward();
+        data.success_data[episode_num] += success_data;
+        data.success_node[episode_num] += success_node;
+        data.cum_reward[episode_num] += cur_reward;
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+        for (auto& node : nodes) {
+            node.reset();
+        }
+    }
+
+    // one-hot state and node number of every node
+    void features(unsigned int frame, Batch& Phi) const {
+        Phi.setZero();
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            Phi(nn, observe_state(node.last_outcome, node.remaining_data, frame)) = 1.0;
+            Phi(nn, NumState + nn) = 1.0;
+        }
+    }
+
+    void choose_action(const Batch& Q, Action& action) {
+        PROFILE_SCOPE(Choose_Action);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (node.is_success) {
+                action[nn] = -1;
+                continue;
+            }
+            if (explore[episode_num] >= get_rand_real(0, 1)) {
+                action[nn] = get_rand_int(0, NumSlot - 1);
+            }
+            else {
+                int index;
+                Q.row(nn).maxCoeff(&index);
+                action[nn] = index;
+            }
+        }
+    }
+
+    void check_collision(const Action& action, Reward& reward, Mask& active) {
+        PROFILE_SCOPE(Collision);
+        double idle = rewards.idle(action);
+        for (auto& node : nodes) {
+            if (node.remaining_data != 0) {
+                auto nn = node.node_num;
+                active[nn] = true;
+                // collision X
+                bool success = std::count(action.begin(), action.end(), action[nn]) == 1;
+                if (success) {
+                    node.last_outcome = Outcome::Success;
+                    --node.remaining_data;
+                    ++success_data;
+                    ++success_frame;
+                    if (node.remaining_data == 0) {
+                        node.is_success = true;
+                    }
+                }
+                // collision O
+                else {
+                    node.last_outcome = Outcome::Collision;
+                }
+                reward[nn] = rewards.step(success, node.remaining_data) + idle;
+            }
+        }
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[frame_num_data++] += success_frame;
+        success_frame = 0;
+    }
+
+    // TD errors of all nodes into D, then one batched gradient step
+    // alpha is split over the two active features of every row
+    void update(const Reward& reward, const Mask& active) {
+        PROFILE_SCOPE(Update);
+        D.setZero();
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (!active[nn]) continue;
+            double target = reward[nn];
+            if (A_2()[nn] >= 0) {
+                target += gamma * Q_2(nn, A_2()[nn]);
+            }
+            D(nn, A_1()[nn]) = target - Q_1(nn, A_1()[nn]);
+            cur_reward += reward[nn];
+        }
+        W.noalias() += (alpha / 2) * Phi_1.transpose() * D;
+    }
+
+    // terminal reward at the greedy slot of the state every node ended in
+    void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        D.setZero();
+        double bonus = rewards.episode_bonus(nodes);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            double reward = rewards.final(node.is_success, bonus);
+            int index;
+            Q_1.row(nn).maxCoeff(&index);
+            D(nn, index) = reward - Q_1(nn, index);
+            cur_reward += reward;
+        }
+        W.noalias() += (alpha / 2) * Phi_1.transpose() * D;
+    }
+
+    void render(int step) {
+        TRACE_INSTANT(2, "frame", "step", step);
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "action", "node", node.node_num, "slot", A_1()[node.node_num]);
+        }
+#endif
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
+    }
+
+    // Optimistic start: the node features carry the return of always succeeding
+    void reset_W() {
+        W = Batch::Zero(NumFeature, NumSlot);
+        W.bottomRows(NumNode) = Batch::Constant(NumNode, NumSlot, positive_feedback / (1 - gamma))
+                                + 0.1 * Batch::Random(NumNode, NumSlot);
+    }
+
+    void reset(bool iteration_end) {
+        for (auto& node : nodes) {
+            node.reset();
+        }
+        if (iteration_end) {
+            reset_W();
+        }
+        frame_num_data = 0;
+        cur_reward = 0;
+    }
+
+    std::string plot_str;
+
+    NodeArr nodes;
+    // actions of the current and the next frame, a frame ends by flipping `current` instead of copying
+    std::array<Action, 2> actions;
+    int current = 0;
+    Action& A_1() { return actions[current]; }
+    Action& A_2() { return actions[current ^ 1]; }
+    Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+
+    double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
+    double alpha = 0.1;
+    double gamma = 0.6;
+
+    Batch W;                // weights [NumFeature x NumSlot]
+    Batch Phi_1, Phi_2;     // features of every node [NumNode x NumFeature]
+    Batch Q_1, Q_2;         // Q rows of every node [NumNode x NumSlot]
+    Batch D;                // TD errors at the chosen slots [NumNode x NumSlot]
+
+    int success_frame = 0;
+    int success_data = 0;
+    int success_node = 0;
+
+    unsigned int total_success = 0;
+    unsigned int total_failure = 0;
+    unsigned int frame_num = 0;
+    unsigned int frame_num_data = 0;
+    unsigned int episode_num = 0;
+
+    double cur_reward = 0;
+};
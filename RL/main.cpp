@@ -1,25 +1,34 @@
-//#define DEBUG
+//#define TRACE_LEVEL 2
 
 
 #include <iostream>
 #include <string>
 
-#include "TD.h"
-#include "RL.h"
+#include "config.h"
 
 
-int main() {
-    SlottedAlohaRL_MC MC_1(0.05);
-    SlottedAlohaRL_MC MC_2(0.5);
-    SlottedAlohaRL_TD TD_1(0.05);
-    SlottedAlohaRL_TD TD_2(0.5);
+// The default comparison, run as an experiment config so its results are cached under keys made
+// from the learners' parameters (config::learner_key), which config runs of the same learners share
+const char default_experiment[] = R"json({
+    "output": { "trace": "trace.json" },
+    "learners": [
+        { "type": "mc", "label": "MC(e=0.05)", "epsilon": 0.05 },
+        { "type": "td", "label": "TD(e=0.05)", "epsilon": 0.05 },
+        { "type": "mc", "label": "MC(e=0.50)", "epsilon": 0.5 },
+        { "type": "td", "label": "TD(e=0.50)", "epsilon": 0.5 }
+    ]
+})json";
 
-    MC_1.run();
-    TD_1.run();
-    MC_2.run();
-    TD_2.run();
 
-    plt::suptitle("Comparison of RL Algorithms via Slotted ALOHA");
-    plt::show();
+// `RL experiment.json` runs the experiment described there (see config.h),
+// without arguments default_experiment runs
+int main(int argc, char** argv) {
+    try {
+        run_experiment(argc > 1 ? load_experiment(argv[1]) : parse_experiment(default_experiment));
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -14,6 +14,10 @@
 
 #include "z_random.h"
 #include "global.h"
+#include "trace.h"
+#include "profile.h"
+#include "reward.h"
+#include "exploration.h"
 
 using namespace Eigen;
 namespace plt = matplotlibcpp;
@@ -35,15 +39,27 @@ public:
         }
     }
     void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    // run every iteration and average the results without plotting
+    void train() {
         std::ios::sync_with_stdio(false);
         init();
-        for (int i = 0; i < iterations_target; i++) {
+        for (int i = 0; i < iterations; i++) {
             run_iteration();
             change_seed();
             reset(true);
         }
         calc_average();
-        plot();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
     }
     void reset() {
         *this = SlottedAlohaRL_n();
@@ -60,11 +76,11 @@ private:
 
         RowVectorXd Q = RowVectorXd::Random(NumSlot);
         unsigned int node_num;
-        unsigned int remaining_data = 10;
+        unsigned int remaining_data = data_target;
         bool is_success = false;
 
         void reset(bool iteration_end) {
-            remaining_data = 10;
+            remaining_data = data_target;
             is_success = false;
             if (iteration_end) {
                 Q = RowVectorXd::Random(NumSlot);
@@ -81,71 +97,51 @@ private:
 
     void init() {
         for (auto& node : nodes) {
-            A_1[node.node_num] = get_rand_int(0, NumSlot - 1);
+            returns[0][node.node_num] = get_rand_int(0, NumSlot - 1);
         }
     }
 
     // This is a block where it runs target number of episodes and finishes
     void run_iteration() {
         for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
-            A_1 = choose_action(A_1);
-            returns[0] = A_1;
+            choose_action(returns[0]);
 
-#ifdef DEBUG
-            cout << "Episode #" << episode_num << ":" << endl;
-#endif 
+            TRACE_BEGIN(1, "episode", "episode", episode_num);
 
             // choose action and update Q matrix every step
             for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
-                check_collision(A_1);
-                A_2 = choose_action(A_1);
-                returns[frame_num + 1] = A_2;
+                check_collision(returns[frame_num]);
+                choose_action(returns[frame_num + 1]);
                 if (cur_update > 0) {
                     update();
                     render(frame_num);
                 }
                 ++cur_update;
-                A_1 = A_2;
             }
             cur_update = 1 - sarsa_size;
 
 
-            // figure out if every node has successfully finished their transmissions
-            bool is_complete = true;
-            for (auto node : nodes) {
-                node.is_success ? ++success_node : is_complete = false;
-            }
+            // success_node counts nodes as they finish (see check_collision)
+            bool is_complete = success_node == NumNode;
+            is_complete ? ++total_success : ++total_failure;
+            trace_policy();
+            TRACE_COUNTER(1, "total_success", total_success);
+            TRACE_COUNTER(1, "total_failure", total_failure);
+            TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
             data.success_data[episode_num] += success_data;
             data.success_node[episode_num] += success_node;
             success_data = 0;
             success_node = 0;
             final_reward();
 
-#ifdef DEBUG
-            cout << "Final policy matrix" << endl;
-            for (auto node : nodes) {
-                cout << std::setprecision(3) << std::fixed << node.Q << endl;
-            }
-
-            if (!is_complete) {
-                cout << "Could not finish transmitting data in " << frame_num_target << " frames." << endl;
-                ++total_failure;
-            }
-            else {
-                cout << "Finished transmitting in " << frame_num << " frames." << endl;
-                ++total_success;
-            }
-            cout << "Total Success: " << total_success << endl;
-            cout << "Total Failure: " << total_failure << endl;
-#endif
 
             std::for_each(nodes.begin(), nodes.end(), [](Node& node) { node.reset(false); });
         }
     }
 
-    // Choose an action based on the given state
-    Action choose_action(const Action& action) {
-        Action action_ret;
+    // Choose the slot of every node into `action_ret`
+    void choose_action(Action& action_ret) {
+        PROFILE_SCOPE(Choose_Action);
         for (auto& node : nodes) {
             if (node.is_success) {
                 action_ret[node.node_num] = -1;
@@ -163,10 +159,10 @@ private:
                 action_ret[node.node_num] = index;
             }
         }
-        return action_ret;
     }
 
     void check_collision(const Action& action) {
+        PROFILE_SCOPE(Collision);
         for (auto& node : nodes) {
             if (std::count(action.begin(), action.end(), action[node.node_num]) == 1) {
                 --node.remaining_data;
@@ -174,34 +170,32 @@ private:
                 ++success_frame;
                 if (node.remaining_data == 0) {
                     node.is_success = true;
+                    ++success_node;
                 }
             }
         }
+        TRACE_COUNTER(2, "success_frame", success_frame);
         data.success_frame[frame_num_data++] += success_frame;
         success_frame = 0;
     }
     // Update Q matrix based on TD algorithm
     void update() {
-        int reward;
+        PROFILE_SCOPE(Update);
+        double reward;
 
         double target[NumNode] = { 0.0 };
         double predict = 0.0;
 
         unsigned int node_num;
         for (int return_num = 0; return_num < sarsa_size; return_num++) {
-            auto action = returns[cur_update + return_num + 1];
+            const auto& action = returns[cur_update + return_num + 1];
+            double idle = rewards.idle(action);
             for (auto& node : nodes) {
                 // getting appropriate rewards
                 if (node.remaining_data != 0) {
                     node_num = node.node_num;
-                    // collision X
-                    if (std::count(action.begin(), action.end(), action[node_num]) == 1) {
-                        reward = positive_feedback;
-                    }
-                    // collision O
-                    else {
-                        reward = negative_feedback;
-                    }
+                    bool success = std::count(action.begin(), action.end(), action[node_num]) == 1;
+                    reward = rewards.step(success, node.remaining_data) + idle;
                     target[node_num] += std::pow(gamma, return_num) * reward;
                 }
 
@@ -226,27 +220,34 @@ private:
     // distribute reward at the end of an episode based on 
     // whether a node has finised transmission or not
     void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        double bonus = rewards.episode_bonus(nodes);
         for (auto& node : nodes) {
             int index = 0;
             node.Q.maxCoeff(&index);
-            if (node.is_success) {
-                node.Q[index] += episode_success;
-            }
-            else {
-                node.Q[index] += episode_failure;
-            }
+            node.Q[index] += rewards.final(node.is_success, bonus);
         }
     }
 
 
-    // rendering which node decided to transmit on which slot
+    // trace which node decided to transmit on which slot
     void render(int step) {
-#ifdef DEBUG
-        printf("Step #%d ", step);
-        for (auto i : A_1) {
-            printf("%2d ", i);
+        TRACE_INSTANT(2, "frame", "step", step);
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "action", "node", node.node_num, "slot", returns[step][node.node_num]);
+        }
+#endif
+    }
+
+    // trace the greedy slot of every node
+    void trace_policy() {
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            int index = 0;
+            node.Q.maxCoeff(&index);
+            TRACE_INSTANT(3, "policy", "node", node.node_num, "slot", index);
         }
-        printf("\n");
 #endif
     }
 
@@ -267,9 +268,10 @@ private:
     }
 
     void calc_average() {
-        std::for_each(data.success_frame.begin(), data.success_frame.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.success_data.begin(), data.success_data.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.success_node.begin(), data.success_node.end(), [](double& val) {val = val / iterations_target; });
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
     }
 
     void reset(bool episode_end) {
@@ -280,12 +282,13 @@ private:
     }
 
     inline double get_epsilon() {
-        return epsilon / episode_num;
+        return explore[episode_num];
     }
     NodeArr nodes;
-    Action A_1, A_2;
-    Action returns[frame_num_target + 1];
+    Action returns[frame_num_target + 1];      // actions of every frame, chosen in place
     Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
 
     std::string plot_str;
 
@@ -296,6 +299,7 @@ private:
     double gamma = 0.6;
     double alpha = 0.1;
     double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
 
 
 
@@ -0,0 +1,18 @@
+#pragma once
+#include <algorithm>
+
+#include "global.h"
+
+// Local observation of a node, shared by the stateful learners
+// (outcome of its own last transmission, backlog bucket, frame phase)
+
+enum class Outcome { Idle, Success, Collision };
+constexpr int NumOutcome = 3;
+constexpr int NumState = NumOutcome * backlog_buckets * frame_phases;
+
+// compact state index in [0, NumState)
+inline int observe_state(Outcome last_outcome, unsigned int remaining_data, unsigned int frame) {
+    int phase = std::min<int>(frame * frame_phases / frame_num_target, frame_phases - 1);
+    int backlog = std::min<int>(remaining_data * backlog_buckets / 10, backlog_buckets - 1);
+    return (static_cast<int>(last_outcome) * backlog_buckets + backlog) * frame_phases + phase;
+}
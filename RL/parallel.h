@@ -0,0 +1,364 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "include.h"
+
+// Reusable barrier for a fixed number of threads
+class Barrier {
+public:
+    explicit Barrier(int count) : count(count) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        unsigned int gen = generation;
+        if (++arrived == count) {
+            arrived = 0;
+            ++generation;
+            cv.notify_all();
+        }
+        else {
+            cv.wait(lock, [&] { return gen != generation; });
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    int count;
+    int arrived = 0;
+    unsigned int generation = 0;
+};
+
+// TD (SARSA) over one large network, sharded across threads within every frame
+// Node count and frame length are set at run time. Every node keeps a Q row over NumSlot
+// candidate slots spread over the frame from a hashed offset, so memory grows with the node
+// count only. Node data is stored as flat arrays and every worker owns a contiguous shard.
+//
+// A frame is three phases separated by barriers:
+//   1. every worker counts the slots its shard transmits on into its own histogram
+//   2. every worker sums a range of slots over all histograms into the shared occupancy
+//   3. every worker scores, chooses the next actions of and updates its shard
+// Worker 0 is the calling thread and also records the results between frames.
+// Of the reward shaping (see reward.h) only the collision and delay terms apply, idle slots and
+// fairness would need another reduction over all workers every frame.
+class SlottedAlohaRL_Parallel {
+public:
+    SlottedAlohaRL_Parallel(int num_nodes = parallel_nodes, int num_threads = parallel_threads, int num_slots = 0,
+                            const double& epsilon = 0.1, const double& alpha = 0.1, const double& gamma = 0.6) :
+        num_nodes(num_nodes), num_slots(frame_slots(num_nodes, num_slots)),
+        epsilon(epsilon), alpha(static_cast<float>(alpha)), gamma(static_cast<float>(gamma)),
+        Q(static_cast<size_t>(num_nodes) * NumSlot), offset(num_nodes), remaining(num_nodes), actions{ { std::vector<int8_t>(num_nodes), std::vector<int8_t>(num_nodes) } },
+        reward(num_nodes), occupancy(this->num_slots)
+    {
+        if (num_threads <= 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        num_threads = std::min(num_threads, num_nodes);
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(2) << epsilon;
+        plot_str = "Parallel TD(n=" + std::to_string(num_nodes) + ", e=" + stream.str() + ")";
+
+        workers.resize(num_threads);
+        for (int w = 0; w < num_threads; w++) {
+            workers[w].begin = static_cast<int>(static_cast<long long>(w) * num_nodes / num_threads);
+            workers[w].end = static_cast<int>(static_cast<long long>(w + 1) * num_nodes / num_threads);
+            workers[w].slot_begin = static_cast<int>(static_cast<long long>(w) * this->num_slots / num_threads);
+            workers[w].slot_end = static_cast<int>(static_cast<long long>(w + 1) * this->num_slots / num_threads);
+            workers[w].histogram.resize(this->num_slots);
+        }
+        // with a frame of NumSlot slots every node sees the whole frame, as in the other learners
+        stride = std::max(1, this->num_slots / NumSlot);
+        for (int n = 0; n < num_nodes; n++) {
+            offset[n] = static_cast<int>(mix(static_cast<uint64_t>(n)) % this->num_slots);
+        }
+    }
+    // slots per frame for `num_slots` as given to the constructor
+    static int frame_slots(int num_nodes, int num_slots) {
+        return std::max(NumSlot, num_slots > 0 ? num_slots : num_nodes);
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    // every worker on its own thread for the whole run, worker 0 on this one
+    void train() {
+        std::ios::sync_with_stdio(false);
+        Barrier barrier(static_cast<int>(workers.size()));
+        iteration_seed = get_seed();
+        std::vector<std::thread> threads;
+        for (int w = 1; w < static_cast<int>(workers.size()); w++) {
+            threads.emplace_back(&SlottedAlohaRL_Parallel::work, this, w, iterations, std::ref(barrier));
+        }
+        work(0, iterations, barrier);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        calc_average();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+    int get_threads() const {
+        return static_cast<int>(workers.size());
+    }
+
+private:
+    // per-thread state
+    struct Worker {
+        int begin, end;                 // nodes of the shard
+        int slot_begin, slot_end;       // slots reduced in phase 2
+        std::vector<int> histogram;
+        std::minstd_rand rng;
+        int success_frame = 0;
+        int success_data = 0;
+        int success_node = 0;
+        bool complete = true;
+        double reward = 0.0;
+        int current = 0;                // actions[current] holds the shard's A_1, flipped after every frame
+        char padding[64];               // counters of neighbouring workers stay on separate cache lines
+    };
+
+    static uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // frame slot of candidate `k` of node `n`, offset and k * stride are both below num_slots
+    int slot_of(int n, int k) const {
+        int slot = offset[n] + k * stride;
+        return slot >= num_slots ? slot - num_slots : slot;
+    }
+    // actions of the current and the next frame of the shard of `me`
+    // Every worker flips its own index, so shards never wait for each other to swap.
+    std::vector<int8_t>& A_1(const Worker& me) {
+        return actions[me.current];
+    }
+    std::vector<int8_t>& A_2(const Worker& me) {
+        return actions[me.current ^ 1];
+    }
+    float* row(int n) {
+        return Q.data() + static_cast<size_t>(n) * NumSlot;
+    }
+
+    void work(int w, int iterations, Barrier& barrier) {
+        for (int i = 0; i < iterations; i++) {
+            run_iteration(w, barrier);
+            barrier.wait();
+            if (w == 0) {
+                iteration_seed = change_seed();
+                frame_num_data = 0;
+            }
+            barrier.wait();
+        }
+    }
+
+    // every worker draws from its own engine, seeded from the iteration seed and its index
+    void run_iteration(int w, Barrier& barrier) {
+        auto& me = workers[w];
+        me.rng.seed(static_cast<unsigned int>(mix(iteration_seed ^ (static_cast<uint64_t>(w) << 32))));
+        std::uniform_real_distribution<float> init(-1.0f, 1.0f);
+        for (int n = me.begin; n < me.end; n++) {
+            for (int k = 0; k < NumSlot; k++) {
+                row(n)[k] = init(me.rng);
+            }
+        }
+
+        for (unsigned int episode = 0; episode < episode_num_target; episode++) {
+            std::fill(remaining.begin() + me.begin, remaining.begin() + me.end, data_target);
+            choose_action(me, A_1(me), episode);
+            if (w == 0) {
+                TRACE_BEGIN(1, "episode", "episode", episode);
+            }
+
+            for (int frame = 0; frame < frame_num_target; frame++) {
+                count_slots(me);
+                barrier.wait();
+                reduce_slots(me);
+                barrier.wait();
+                check_collision(me);
+                choose_action(me, A_2(me), episode);
+                update(me);
+                me.current ^= 1;
+                barrier.wait();
+                if (w == 0) {
+                    record_frame();
+                }
+            }
+
+            final_reward(me);
+            barrier.wait();
+            if (w == 0) {
+                record_episode(episode);
+            }
+            barrier.wait();
+        }
+    }
+
+    // phase 1: slots of the shard's transmissions into the worker's histogram
+    void count_slots(Worker& me) {
+        PROFILE_SCOPE(Collision);
+        std::fill(me.histogram.begin(), me.histogram.end(), 0);
+        for (int n = me.begin; n < me.end; n++) {
+            if (A_1(me)[n] >= 0) {
+                ++me.histogram[slot_of(n, A_1(me)[n])];
+            }
+        }
+    }
+
+    // phase 2: the worker's range of slots summed over every histogram
+    void reduce_slots(Worker& me) {
+        PROFILE_SCOPE(Collision);
+        for (int s = me.slot_begin; s < me.slot_end; s++) {
+            int count = 0;
+            for (auto& worker : workers) {
+                count += worker.histogram[s];
+            }
+            occupancy[s] = count;
+        }
+    }
+
+    // phase 3: a transmission succeeds when it is alone in its slot
+    void check_collision(Worker& me) {
+        PROFILE_SCOPE(Collision);
+        me.success_frame = 0;
+        for (int n = me.begin; n < me.end; n++) {
+            if (remaining[n] == 0) continue;
+            bool success = occupancy[slot_of(n, A_1(me)[n])] == 1;
+            if (success) {
+                --remaining[n];
+                ++me.success_data;
+                ++me.success_frame;
+            }
+            reward[n] = static_cast<float>(rewards.step(success, remaining[n]));
+        }
+    }
+
+    void choose_action(Worker& me, std::vector<int8_t>& action, unsigned int episode) {
+        PROFILE_SCOPE(Choose_Action);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::uniform_int_distribution<int> pick(0, NumSlot - 1);
+        for (int n = me.begin; n < me.end; n++) {
+            if (remaining[n] == 0) {
+                action[n] = -1;
+            }
+            else if (explore[episode] >= unit(me.rng)) {
+                action[n] = static_cast<int8_t>(pick(me.rng));
+            }
+            else {
+                const float* q = row(n);
+                action[n] = static_cast<int8_t>(std::max_element(q, q + NumSlot) - q);
+            }
+        }
+    }
+
+    // SARSA on A_1 -> A_2 for the nodes that transmitted this frame
+    void update(Worker& me) {
+        PROFILE_SCOPE(Update);
+        for (int n = me.begin; n < me.end; n++) {
+            if (A_1(me)[n] < 0) continue;
+            float* q = row(n);
+            float next = A_2(me)[n] >= 0 ? q[A_2(me)[n]] : 0.0f;
+            float target = reward[n] + gamma * next;
+            q[A_1(me)[n]] += alpha * (target - q[A_1(me)[n]]);
+            me.reward += reward[n];
+        }
+    }
+
+    void final_reward(Worker& me) {
+        PROFILE_SCOPE(Final_Reward);
+        me.success_node = 0;
+        me.complete = true;
+        for (int n = me.begin; n < me.end; n++) {
+            bool success = remaining[n] == 0;
+            success ? ++me.success_node : me.complete = false;
+            float* q = row(n);
+            float* best = std::max_element(q, q + NumSlot);
+            double bonus = rewards.final(success);
+            *best += static_cast<float>(bonus);
+            me.reward += bonus;
+        }
+    }
+
+    // worker 0 only, while the others wait at the next barrier
+    void record_frame() {
+        int success_frame = 0;
+        for (auto& worker : workers) {
+            success_frame += worker.success_frame;
+        }
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[frame_num_data++] += success_frame;
+    }
+
+    void record_episode(unsigned int episode) {
+        int success_data = 0, success_node = 0;
+        bool complete = true;
+        double reward = 0.0;
+        for (auto& worker : workers) {
+            success_data += worker.success_data;
+            success_node += worker.success_node;
+            complete = complete && worker.complete;
+            reward += worker.reward;
+            worker.success_data = 0;
+            worker.reward = 0.0;
+        }
+        complete ? ++total_success : ++total_failure;
+        TRACE_END(1, "episode", "success_node", success_node, "complete", complete);
+        data.success_data[episode] += success_data;
+        data.success_node[episode] += success_node;
+        data.cum_reward[episode] += reward;
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
+    }
+
+    std::string plot_str;
+
+    int num_nodes;
+    int num_slots;
+    int stride = 1;
+
+    double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
+    float alpha = 0.1f;
+    float gamma = 0.6f;
+
+    // node arrays, indexed by node number
+    std::vector<float> Q;               // [num_nodes x NumSlot]
+    std::vector<int> offset;            // first candidate slot
+    std::vector<uint8_t> remaining;
+    std::array<std::vector<int8_t>, 2> actions;     // candidate index, -1 once done
+    std::vector<float> reward;
+
+    std::vector<int> occupancy;         // transmissions per slot of the current frame
+    std::vector<Worker> workers;
+    unsigned int iteration_seed = 0;    // engines are per thread, so worker 0 hands the seed to the others
+    Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+
+    unsigned int total_success = 0;
+    unsigned int total_failure = 0;
+    unsigned int frame_num_data = 0;
+};
@@ -0,0 +1,177 @@
+#pragma once
+// Per-phase timers for the learners' hot path
+//
+// PROFILE_SCOPE(phase) adds the ticks spent in the enclosing scope to a per-thread counter.
+// Ticks come from the TSC where available (a couple of nanoseconds per scope) and from
+// steady_clock otherwise, so the timers stay on in normal runs.
+// Define PROFILE_PHASES 0 to compile them out.
+
+#ifndef PROFILE_PHASES
+#define PROFILE_PHASES 1
+#endif
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace profile {
+
+enum Phase {
+    Choose_Action,
+    Collision,
+    Update,
+    Final_Reward,
+    Calc_Average,
+    Num_Phase
+};
+
+inline const char* phase_name(int phase) {
+    static const char* const names[Num_Phase] = { "choose_action", "collision", "update", "final_reward", "calc_average" };
+    return names[phase];
+}
+
+inline uint64_t ticks() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct Counters {
+    std::array<uint64_t, Num_Phase> ticks = { 0 };
+    std::array<uint64_t, Num_Phase> calls = { 0 };
+    unsigned int tid;
+};
+
+class Registry {
+public:
+    Registry() : start_ticks(ticks()), start_time(std::chrono::steady_clock::now()) {}
+
+    Counters* add_counters() {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.emplace_back(new Counters);
+        threads.back()->tid = static_cast<unsigned int>(threads.size() - 1);
+        return threads.back().get();
+    }
+
+    // ticks are converted by comparing them against steady_clock since the registry was created
+    double ns_per_tick() const {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+        auto elapsed_ticks = ticks() - start_ticks;
+        return elapsed_ticks == 0 ? 1.0 : static_cast<double>(elapsed) / elapsed_ticks;
+    }
+
+    // Breakdown table summed over threads, per-thread rows are appended to `csv_path` if it is given
+    // Should only be called while no other thread is profiling
+    void report(const std::string& label, const std::string& csv_path = "") {
+        std::lock_guard<std::mutex> lock(mutex);
+        double scale = ns_per_tick();
+        std::array<uint64_t, Num_Phase> ticks = { 0 }, calls = { 0 };
+        uint64_t total = 0;
+        for (auto& thread : threads) {
+            for (int p = 0; p < Num_Phase; p++) {
+                ticks[p] += thread->ticks[p];
+                calls[p] += thread->calls[p];
+                total += thread->ticks[p];
+            }
+        }
+
+        std::cout << "Profile: " << label << "\n"
+                  << std::left << std::setw(16) << "phase" << std::right
+                  << std::setw(12) << "calls" << std::setw(12) << "ms" << std::setw(12) << "ns/call" << std::setw(9) << "share" << "\n";
+        for (int p = 0; p < Num_Phase; p++) {
+            double ns = ticks[p] * scale;
+            std::cout << std::left << std::setw(16) << phase_name(p) << std::right << std::fixed
+                      << std::setw(12) << calls[p]
+                      << std::setw(12) << std::setprecision(2) << ns / 1e6
+                      << std::setw(12) << std::setprecision(1) << (calls[p] ? ns / calls[p] : 0.0)
+                      << std::setw(8) << std::setprecision(1) << (total ? 100.0 * ticks[p] / total : 0.0) << "%\n";
+        }
+        std::cout.flush();
+        if (csv_path.empty()) return;
+
+        std::ifstream exists(csv_path);
+        bool header = !exists.good() || exists.peek() == std::ifstream::traits_type::eof();
+        exists.close();
+        std::ofstream csv(csv_path, std::ios::app);
+        if (header) {
+            csv << "label,thread,phase,calls,ticks,ns\n";
+        }
+        for (auto& thread : threads) {
+            for (int p = 0; p < Num_Phase; p++) {
+                if (thread->calls[p] == 0) continue;
+                csv << '"' << label << "\"," << thread->tid << ',' << phase_name(p) << ','
+                    << thread->calls[p] << ',' << thread->ticks[p] << ',' << static_cast<uint64_t>(thread->ticks[p] * scale) << '\n';
+            }
+        }
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& thread : threads) {
+            thread->ticks.fill(0);
+            thread->calls.fill(0);
+        }
+    }
+
+private:
+    uint64_t start_ticks;
+    std::chrono::steady_clock::time_point start_time;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Counters>> threads;
+};
+
+inline Registry& registry() {
+    static Registry reg;
+    return reg;
+}
+
+inline Counters& counters() {
+    static thread_local Counters* c = registry().add_counters();
+    return *c;
+}
+
+class Scoped_Timer {
+public:
+    Scoped_Timer(Phase phase) : phase(phase), start(ticks()) {}
+    ~Scoped_Timer() {
+        auto& c = counters();
+        c.ticks[phase] += ticks() - start;
+        ++c.calls[phase];
+    }
+private:
+    Phase phase;
+    uint64_t start;
+};
+
+// print the breakdown of `label`, append it to `csv_path` if given, and start counting from zero again
+inline void report(const std::string& label, const std::string& csv_path = "") {
+#if PROFILE_PHASES
+    registry().report(label, csv_path);
+    registry().reset();
+#endif
+}
+
+}   // namespace profile
+
+#if PROFILE_PHASES
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) profile::Scoped_Timer PROFILE_CONCAT(profile_scope_, __LINE__)(profile::phase)
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#endif
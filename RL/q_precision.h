@@ -0,0 +1,66 @@
+#pragma once
+#include "TD.h"
+
+// Accuracy report of Q storage types
+// Every type is trained from the same seed and the same initial Q matrices, then compared
+// against double storage by its learned greedy policies and its reward curve.
+
+struct Precision_Result {
+    std::string name;
+    size_t q_bytes;                                         // Q storage per node
+    Plot_Data data;
+    std::vector<Replay_Action> policies;
+};
+
+template <typename Value>
+Precision_Result train_precision(double epsilon, unsigned int seed) {
+    set_seed(seed);
+    std::srand(seed);
+    SlottedAlohaRL_TD<Value> learner(epsilon);
+    learner.train();
+    // timings of these runs would otherwise end up in the next learner's profile
+    profile::registry().reset();
+    return { Q_Traits<Value>::name(), sizeof(typename Q_Traits<Value>::storage) * NumSlot, learner.get_data(), learner.get_policies() };
+}
+
+// nodes that ended up on a slot of their own
+inline int collision_free_nodes(const Replay_Action& policy) {
+    int count = 0;
+    for (auto slot : policy) {
+        if (std::count(policy.begin(), policy.end(), slot) == 1) ++count;
+    }
+    return count;
+}
+
+inline void precision_report(double epsilon = 0.05, unsigned int seed = 1) {
+    std::vector<Precision_Result> results;
+    results.push_back(train_precision<double>(epsilon, seed));
+    results.push_back(train_precision<float>(epsilon, seed));
+    results.push_back(train_precision<Fixed16<>>(epsilon, seed));
+
+    const auto& ref = results[0];
+    cout << "Q storage accuracy, TD(e=" << epsilon << "), seed " << seed << "\n"
+         << std::left << std::setw(10) << "type" << std::right
+         << std::setw(10) << "bytes" << std::setw(12) << "agreement" << std::setw(16) << "collision-free"
+         << std::setw(14) << "final reward" << std::setw(14) << "max |diff|" << "\n";
+    for (auto& res : results) {
+        int same = 0, free = 0;
+        for (int i = 0; i < iterations_target; i++) {
+            for (int n = 0; n < NumNode; n++) {
+                if (res.policies[i][n] == ref.policies[i][n]) ++same;
+            }
+            free += collision_free_nodes(res.policies[i]);
+        }
+        double max_diff = 0.0;
+        for (int ep = 0; ep < episode_num_target; ep++) {
+            max_diff = std::max(max_diff, std::abs(res.data.cum_reward[ep] - ref.data.cum_reward[ep]));
+        }
+        cout << std::left << std::setw(10) << res.name << std::right << std::fixed
+             << std::setw(10) << res.q_bytes
+             << std::setw(11) << std::setprecision(1) << 100.0 * same / (iterations_target * NumNode) << "%"
+             << std::setw(15) << std::setprecision(1) << 100.0 * free / (iterations_target * NumNode) << "%"
+             << std::setw(14) << std::setprecision(2) << res.data.cum_reward.back()
+             << std::setw(14) << std::setprecision(2) << max_diff << "\n";
+    }
+    cout.flush();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <string>
+
+#include <Eigen/Dense>
+
+// Value types for Q matrix storage
+//
+//   double        8 bytes per entry (default)
+//   float         4 bytes per entry
+//   Fixed16<F>    2 bytes per entry, signed fixed point with F fractional bits
+//
+// Q_Traits<Value>::storage is what the Q matrix holds and Q_Traits<Value>::real is
+// the type TD arithmetic is done in before rounding back into storage.
+
+// Q7.8 by default: range [-128, 128) with a resolution of 1/256
+// TD Q values stay within a few tens of the episode reward, values outside the range saturate
+template <int Frac = 8>
+struct Fixed16 {};
+
+template <typename Value>
+struct Q_Traits {
+    typedef Value storage;
+    typedef Value real;
+
+    static real to_real(storage val) { return val; }
+    static storage from_real(real val) { return val; }
+    static std::string name() { return sizeof(Value) == sizeof(float) ? "float" : "double"; }
+};
+
+template <int Frac>
+struct Q_Traits<Fixed16<Frac>> {
+    typedef int16_t storage;
+    typedef float real;
+
+    static real to_real(storage val) { return val * (1.0f / (1 << Frac)); }
+    static storage from_real(real val) {
+        float scaled = std::nearbyint(val * (1 << Frac));
+        if (scaled > INT16_MAX) return INT16_MAX;
+        if (scaled < INT16_MIN) return INT16_MIN;
+        return static_cast<storage>(scaled);
+    }
+    static std::string name() { return "q" + std::to_string(15 - Frac) + "." + std::to_string(Frac); }
+};
+
+template <typename Value>
+using Q_Row = Eigen::Matrix<typename Q_Traits<Value>::storage, 1, Eigen::Dynamic>;
+
+// uniform random Q row in [-1, 1], same draws for every value type
+template <typename Value>
+Q_Row<Value> random_q_row(int size) {
+    return Eigen::RowVectorXd::Random(size).unaryExpr([](double val) {
+        return Q_Traits<Value>::from_real(static_cast<typename Q_Traits<Value>::real>(val));
+    });
+}
+
+// Q row as an expression of the arithmetic type, without a copy
+template <typename Value>
+auto q_row_real(const Q_Row<Value>& Q) {
+    return Q.unaryExpr([](typename Q_Traits<Value>::storage val) {
+        return Q_Traits<Value>::to_real(val);
+    });
+}
+
+template <typename Value>
+Eigen::RowVectorXd q_row_to_double(const Q_Row<Value>& Q) {
+    return Q.unaryExpr([](typename Q_Traits<Value>::storage val) {
+        return static_cast<double>(Q_Traits<Value>::to_real(val));
+    });
+}
+
+template <typename Value>
+Q_Row<Value> q_row_from_double(const Eigen::RowVectorXd& Q) {
+    return Q.unaryExpr([](double val) {
+        return Q_Traits<Value>::from_real(static_cast<typename Q_Traits<Value>::real>(val));
+    });
+}
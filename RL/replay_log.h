@@ -0,0 +1,317 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+
+#include "global.h"
+
+// Compact binary log of everything a learner's update path consumes:
+// random seeds and initial Q matrices per iteration, the initial action of every episode,
+// per-frame action vectors and rewards, and the final rewards of every episode.
+// Replaying a log re-drives a learner's Q updates without re-simulating the channel.
+//
+// Layout: header ("SARL", version, flags, NumNode, NumSlot) followed by tagged records.
+// Integers are LEB128 varints, signed values are zigzag encoded and
+// actions/rewards are stored as deltas from the previous record of the same node.
+// Rewards are fixed point with 3 decimal places while they are plain reward constants with at most
+// 3 decimals. With reward shaping, or finer constants, they are stored as raw doubles instead
+// (flag replay_exact_rewards), 8 bytes per node and reward but exact.
+
+typedef std::array<int, NumNode> Replay_Action;
+typedef std::array<double, NumNode> Replay_Reward;
+typedef std::array<bool, NumNode> Replay_Mask;
+
+constexpr double replay_reward_scale = 1000.0;  // fixed point rewards are kept with 3 decimal places
+constexpr uint8_t replay_version = 3;
+constexpr uint8_t replay_exact_rewards = 1;     // header flag, rewards are raw doubles
+
+// whether every reward of the current constants survives the fixed point encoding
+inline bool replay_fixed_point(const Reward_Constants& r) {
+    auto exact = [](double val) { return std::llround(val * replay_reward_scale) / replay_reward_scale == val; };
+    bool shaped = r.collision_penalty != 0.0 || r.idle_penalty != 0.0 || r.delay_penalty != 0.0 || r.fairness_bonus != 0.0;
+    return !shaped && exact(r.positive_feedback) && exact(r.negative_feedback)
+        && exact(r.episode_success) && exact(r.episode_failure);
+}
+
+enum class Replay_Tag : uint8_t {
+    Iteration = 1,      // seed + number of Q matrices + initial Q matrices
+    Episode = 2,        // episode number + initial action
+    Frame = 3,          // action, active nodes, rewards
+    Episode_End = 4,    // final rewards
+};
+
+struct Replay_Record {
+    Replay_Tag tag;
+    unsigned int seed = 0;
+    unsigned int iteration = 0;
+    unsigned int episode = 0;
+    std::vector<double> Q;      // NumNode * NumSlot per matrix, node major, Double Q logs Q_B after Q
+    Replay_Action action = { 0 };
+    Replay_Reward reward = { 0.0 };
+    Replay_Mask active = { false };
+};
+
+class Replay_Writer {
+public:
+    Replay_Writer(const std::string& path) : out(path, std::ios::binary), exact_rewards(!replay_fixed_point(reward_constants())) {
+        if (!out) {
+            throw std::runtime_error("cannot open replay log " + path);
+        }
+        uint8_t flags = exact_rewards ? replay_exact_rewards : 0;
+        buffer.insert(buffer.end(), { 'S', 'A', 'R', 'L', replay_version, flags });
+        put_varint(NumNode);
+        put_varint(NumSlot);
+    }
+    ~Replay_Writer() {
+        flush();
+    }
+
+    // `Q` holds one or more matrices of NumNode * NumSlot values
+    void iteration(unsigned int seed, const std::vector<double>& Q) {
+        put_tag(Replay_Tag::Iteration);
+        put_varint(seed);
+        put_varint(Q.size() / (NumNode * NumSlot));
+        for (auto q : Q) {
+            put_double(q);
+        }
+        last_action.fill(0);
+        last_reward.fill(0);
+    }
+
+    void episode(unsigned int episode_num, const Replay_Action& action) {
+        put_tag(Replay_Tag::Episode);
+        put_varint(episode_num);
+        put_action(action);
+    }
+
+    void frame(const Replay_Action& action, const Replay_Reward& reward, const Replay_Mask& active) {
+        put_tag(Replay_Tag::Frame);
+        put_action(action);
+        put_mask(active);
+        put_reward(reward);
+    }
+
+    void episode_end(const Replay_Reward& reward) {
+        put_tag(Replay_Tag::Episode_End);
+        put_reward(reward);
+        if (buffer.size() > (1 << 20)) {
+            flush();
+        }
+    }
+
+    void flush() {
+        out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        out.flush();
+        buffer.clear();
+    }
+
+private:
+    void put_tag(Replay_Tag tag) {
+        buffer.push_back(static_cast<uint8_t>(tag));
+    }
+    void put_varint(uint64_t val) {
+        while (val >= 0x80) {
+            buffer.push_back(static_cast<uint8_t>(val | 0x80));
+            val >>= 7;
+        }
+        buffer.push_back(static_cast<uint8_t>(val));
+    }
+    void put_zigzag(int64_t val) {
+        put_varint((static_cast<uint64_t>(val) << 1) ^ static_cast<uint64_t>(val >> 63));
+    }
+    void put_double(double val) {
+        uint64_t bits;
+        std::memcpy(&bits, &val, sizeof(bits));
+        for (int i = 0; i < 8; i++) {
+            buffer.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+    }
+    void put_action(const Replay_Action& action) {
+        for (int i = 0; i < NumNode; i++) {
+            put_zigzag(action[i] - last_action[i]);
+            last_action[i] = action[i];
+        }
+    }
+    void put_reward(const Replay_Reward& reward) {
+        for (int i = 0; i < NumNode; i++) {
+            if (exact_rewards) {
+                put_double(reward[i]);
+                continue;
+            }
+            int64_t fixed = std::llround(reward[i] * replay_reward_scale);
+            put_zigzag(fixed - last_reward[i]);
+            last_reward[i] = fixed;
+        }
+    }
+    void put_mask(const Replay_Mask& mask) {
+        uint8_t byte = 0;
+        for (int i = 0; i < NumNode; i++) {
+            if (mask[i]) byte |= 1 << (i % 8);
+            if (i % 8 == 7 || i == NumNode - 1) {
+                buffer.push_back(byte);
+                byte = 0;
+            }
+        }
+    }
+
+    std::ofstream out;
+    bool exact_rewards;
+    std::vector<uint8_t> buffer;
+    Replay_Action last_action = { 0 };
+    std::array<int64_t, NumNode> last_reward = { 0 };
+};
+
+class Replay_Reader {
+public:
+    Replay_Reader(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("cannot open replay log " + path);
+        }
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (buffer.size() < 6 || std::memcmp(buffer.data(), "SARL", 4) != 0 || buffer[4] != replay_version) {
+            throw std::runtime_error("not a replay log: " + path);
+        }
+        exact_rewards = (buffer[5] & replay_exact_rewards) != 0;
+        pos = 6;
+        if (get_varint() != NumNode || get_varint() != NumSlot) {
+            throw std::runtime_error("replay log was recorded with a different NumNode/NumSlot");
+        }
+    }
+
+    // decode the next record, returns false at the end of the log
+    bool next(Replay_Record& rec) {
+        if (pos >= buffer.size()) return false;
+        rec.tag = static_cast<Replay_Tag>(buffer[pos++]);
+        switch (rec.tag) {
+        case Replay_Tag::Iteration:
+            rec.seed = static_cast<unsigned int>(get_varint());
+            rec.Q.resize(get_varint() * NumNode * NumSlot);
+            for (auto& q : rec.Q) {
+                q = get_double();
+            }
+            rec.iteration = iteration++;
+            last_action.fill(0);
+            last_reward.fill(0);
+            break;
+        case Replay_Tag::Episode:
+            rec.episode = static_cast<unsigned int>(get_varint());
+            get_action(rec.action);
+            break;
+        case Replay_Tag::Frame:
+            get_action(rec.action);
+            get_mask(rec.active);
+            get_reward(rec.reward);
+            break;
+        case Replay_Tag::Episode_End:
+            get_reward(rec.reward);
+            break;
+        default:
+            throw std::runtime_error("corrupt replay log");
+        }
+        return true;
+    }
+
+private:
+    uint8_t get_byte() {
+        if (pos >= buffer.size()) {
+            throw std::runtime_error("truncated replay log");
+        }
+        return buffer[pos++];
+    }
+    uint64_t get_varint() {
+        uint64_t val = 0;
+        for (int shift = 0; ; shift += 7) {
+            uint8_t byte = get_byte();
+            val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return val;
+        }
+    }
+    int64_t get_zigzag() {
+        uint64_t val = get_varint();
+        return static_cast<int64_t>(val >> 1) ^ -static_cast<int64_t>(val & 1);
+    }
+    double get_double() {
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; i++) {
+            bits |= static_cast<uint64_t>(get_byte()) << (8 * i);
+        }
+        double val;
+        std::memcpy(&val, &bits, sizeof(val));
+        return val;
+    }
+    void get_action(Replay_Action& action) {
+        for (int i = 0; i < NumNode; i++) {
+            last_action[i] += static_cast<int>(get_zigzag());
+            action[i] = last_action[i];
+        }
+    }
+    void get_reward(Replay_Reward& reward) {
+        for (int i = 0; i < NumNode; i++) {
+            if (exact_rewards) {
+                reward[i] = get_double();
+                continue;
+            }
+            last_reward[i] += get_zigzag();
+            reward[i] = last_reward[i] / replay_reward_scale;
+        }
+    }
+    void get_mask(Replay_Mask& mask) {
+        uint8_t byte = 0;
+        for (int i = 0; i < NumNode; i++) {
+            if (i % 8 == 0) byte = get_byte();
+            mask[i] = (byte >> (i % 8)) & 1;
+        }
+    }
+
+    std::vector<uint8_t> buffer;
+    size_t pos = 0;
+    bool exact_rewards = false;
+    unsigned int iteration = 0;
+    Replay_Action last_action = { 0 };
+    std::array<int64_t, NumNode> last_reward = { 0 };
+};
+
+// Feed a replay log into any learner implementing
+//     replay_iteration(seed, Q), replay_episode(episode, action),
+//     replay_frame(action, reward, active), replay_episode_end(reward)
+// Starts at `first_iteration`, whose record carries its seed and initial Q matrices, so earlier
+// iterations are only decoded and never fed. Stops after `last_iteration` when it is not negative.
+// replay(path, learner, n, n) reproduces iteration n alone. Returns the number of iterations replayed.
+template <typename Learner>
+int replay(const std::string& path, Learner& learner, int last_iteration = -1, int first_iteration = 0) {
+    Replay_Reader reader(path);
+    Replay_Record rec;
+    int iterations = 0;
+    bool skipping = first_iteration > 0;
+    while (reader.next(rec)) {
+        if (rec.tag == Replay_Tag::Iteration) {
+            skipping = static_cast<int>(rec.iteration) < first_iteration;
+        }
+        if (skipping) continue;
+        switch (rec.tag) {
+        case Replay_Tag::Iteration:
+            if (last_iteration >= 0 && static_cast<int>(rec.iteration) > last_iteration) {
+                return iterations;
+            }
+            learner.replay_iteration(rec.seed, rec.Q);
+            ++iterations;
+            break;
+        case Replay_Tag::Episode:
+            learner.replay_episode(rec.episode, rec.action);
+            break;
+        case Replay_Tag::Frame:
+            learner.replay_frame(rec.action, rec.reward, rec.active);
+            break;
+        case Replay_Tag::Episode_End:
+            learner.replay_episode_end(rec.reward);
+            break;
+        }
+    }
+    return iterations;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <algorithm>
+
+#include "global.h"
+
+// Reward shaping
+// Built once from reward_constants() when a learner is made, so the per-frame loops look rewards up
+// by (outcome, remaining data) and by the number of idle slots instead of branching on the shaping.
+//   success     positive_feedback - delay
+//   collision   negative_feedback - collision_penalty - delay
+//   idle        -idle_penalty * idle slots / NumSlot, added for every node that still has data
+//   delay       delay_penalty * remaining data / data_target after the frame
+//   episode end episode_success or episode_failure, + fairness_bonus * Jain's index of delivered data
+// With the shaping terms at 0 every reward is exactly the unshaped constant.
+class Reward_Table {
+public:
+    Reward_Table() {
+        build(reward_constants());
+    }
+    void build(const Reward_Constants& r) {
+        for (int remaining = 0; remaining <= data_target; remaining++) {
+            double delay = r.delay_penalty * remaining / data_target;
+            table[0][remaining] = r.negative_feedback - r.collision_penalty - delay;
+            table[1][remaining] = r.positive_feedback - delay;
+        }
+        for (int idle = 0; idle <= NumSlot; idle++) {
+            idle_table[idle] = -r.idle_penalty * idle / NumSlot;
+        }
+        delay_slope = r.delay_penalty / data_target;
+        terminal[0] = r.episode_failure;
+        terminal[1] = r.episode_success;
+        shape_idle = r.idle_penalty != 0.0;
+        fairness_bonus = r.fairness_bonus;
+    }
+
+    // reward of a node that transmitted and has `remaining` data left afterwards
+    double step(bool success, unsigned int remaining) const {
+        return table[success][std::min<unsigned int>(remaining, data_target)];
+    }
+
+    // step() is step_base(success) - delay_per_data() * remaining, for callers that compute it over arrays
+    double step_base(bool success) const {
+        return table[success][0];
+    }
+    double delay_per_data() const {
+        return delay_slope;
+    }
+
+    // idle slot penalty of a frame, `action` holds a slot or -1 per node
+    template <typename Action>
+    double idle(const Action& action) const {
+        if (!shape_idle) return 0.0;
+        std::array<bool, NumSlot> used = { false };
+        int idle = NumSlot;
+        for (auto slot : action) {
+            if (slot >= 0 && slot < NumSlot && !used[slot]) {
+                used[slot] = true;
+                --idle;
+            }
+        }
+        return idle_table[idle];
+    }
+
+    // fairness part of the episode reward, the same for every node
+    // `nodes` are anything with remaining_data
+    template <typename Nodes>
+    double episode_bonus(const Nodes& nodes) const {
+        if (fairness_bonus == 0.0) return 0.0;
+        double sum = 0.0, square = 0.0;
+        int count = 0;
+        for (auto& node : nodes) {
+            double delivered = data_target - static_cast<double>(node.remaining_data);
+            sum += delivered;
+            square += delivered * delivered;
+            ++count;
+        }
+        return square > 0.0 ? fairness_bonus * sum * sum / (count * square) : 0.0;
+    }
+
+    double final(bool success, double bonus = 0.0) const {
+        return terminal[success] + bonus;
+    }
+
+private:
+    double table[2][data_target + 1];       // [success][remaining data]
+    std::array<double, NumSlot + 1> idle_table;
+    double terminal[2];                     // [success]
+    double delay_slope = 0.0;
+    bool shape_idle = false;
+    double fairness_bonus = 0.0;
+};
@@ -14,6 +14,10 @@
 
 #include "z_random.h"
 #include "global.h"
+#include "trace.h"
+#include "profile.h"
+#include "reward.h"
+#include "exploration.h"
 
 using namespace Eigen;
 namespace plt = matplotlibcpp;
@@ -35,15 +39,27 @@ public:
         }
     }
     void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    // run every iteration and average the results without plotting
+    void train() {
         std::ios::sync_with_stdio(false);
         init();
-        for (int i = 0; i < iterations_target; i++) {
+        for (int i = 0; i < iterations; i++) {
             run_iteration();
             change_seed();
             reset(true);
         }
         calc_average();
-        plot();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
     }
     void reset() {
         *this = SlottedAlohaRL_Ramda();
@@ -60,11 +76,11 @@ private:
 
         RowVectorXd Q = RowVectorXd::Random(NumSlot);
         unsigned int node_num;
-        unsigned int remaining_data = 10;
+        unsigned int remaining_data = data_target;
         bool is_success = false;
         std::array<int, NumSlot> e_trace = { 0 };
         void reset(bool iteration_end) {
-            remaining_data = 10;
+            remaining_data = data_target;
             is_success = false;
             std::fill(e_trace.begin(), e_trace.end(), 0);
             if (iteration_end) {
@@ -82,66 +98,48 @@ private:
 
     void init() {
         for (auto& node : nodes) {
-            A_1[node.node_num] = get_rand_int(0, NumSlot - 1);
+            A_1()[node.node_num] = get_rand_int(0, NumSlot - 1);
         }
     }
 
     // This is a block where it runs target number of episodes and finishes
     void run_iteration() {
         for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
-            A_1 = choose_action(A_1);
-            returns[0] = A_1;
+            choose_action(A_1());
 
-#ifdef DEBUG
-            cout << "Episode #" << episode_num << ":" << endl;
-#endif 
+            TRACE_BEGIN(1, "episode", "episode", episode_num);
 
             // choose action and update Q matrix every step
             for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
-                check_collision(A_1);
-                A_2 = choose_action(A_1);
+                check_collision(A_1());
+                choose_action(A_2());
                 update();
                 render(frame_num);
-                A_1 = A_2;
+                current ^= 1;
             }
 
 
-            // figure out if every node has successfully finished their transmissions
-            bool is_complete = true;
-            for (auto node : nodes) {
-                node.is_success ? ++success_node : is_complete = false;
-            }
+            // success_node counts nodes as they finish (see check_collision)
+            bool is_complete = success_node == NumNode;
+            is_complete ? ++total_success : ++total_failure;
+            trace_policy();
+            TRACE_COUNTER(1, "total_success", total_success);
+            TRACE_COUNTER(1, "total_failure", total_failure);
+            TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
             data.success_data[episode_num] += success_data;
             data.success_node[episode_num] += success_node;
             success_data = 0;
             success_node = 0;
             final_reward();
 
-#ifdef DEBUG
-            cout << "Final policy matrix" << endl;
-            for (auto node : nodes) {
-                cout << std::setprecision(3) << std::fixed << node.Q << endl;
-            }
-
-            if (!is_complete) {
-                cout << "Could not finish transmitting data in " << frame_num_target << " frames." << endl;
-                ++total_failure;
-            }
-            else {
-                cout << "Finished transmitting in " << frame_num << " frames." << endl;
-                ++total_success;
-            }
-            cout << "Total Success: " << total_success << endl;
-            cout << "Total Failure: " << total_failure << endl;
-#endif
 
             std::for_each(nodes.begin(), nodes.end(), [](Node& node) { node.reset(false); });
         }
     }
 
-    // Choose an action based on the given state
-    Action choose_action(const Action& action) {
-        Action action_ret;
+    // Choose the slot of every node into `action_ret`
+    void choose_action(Action& action_ret) {
+        PROFILE_SCOPE(Choose_Action);
         for (auto& node : nodes) {
             if (node.is_success) {
                 action_ret[node.node_num] = -1;
@@ -161,10 +159,10 @@ private:
                 ++node.e_trace[index];
             }
         }
-        return action_ret;
     }
 
     void check_collision(const Action& action) {
+        PROFILE_SCOPE(Collision);
         for (auto& node : nodes) {
             if (std::count(action.begin(), action.end(), action[node.node_num]) == 1) {
                 --node.remaining_data;
@@ -172,38 +170,38 @@ private:
                 ++success_frame;
                 if (node.remaining_data == 0) {
                     node.is_success = true;
+                    ++success_node;
                 }
             }
         }
+        TRACE_COUNTER(2, "success_frame", success_frame);
         data.success_frame[frame_num_data++] += success_frame;
         success_frame = 0;
     }
 
     // Update Q matrix based on TD algorithm
     void update() {
-        int reward;
+        PROFILE_SCOPE(Update);
+        double reward;
 
         double target[NumNode] = { 0.0 };
         double predict = 0.0;
 
         unsigned int node_num;
         double delta;
+        const Action& action = A_1();
+        const Action& next = A_2();
+        double idle = rewards.idle(next);
         for (auto& node : nodes) {
             // getting appropriate rewards
             if (node.remaining_data != 0) {
                 node_num = node.node_num;
-                // collision X
-                if (std::count(A_2.begin(), A_2.end(), A_2[node_num]) == 1) {
-                    reward = positive_feedback;
-                }
-                // collision O
-                else {
-                    reward = negative_feedback;
-                }
-                double predict = node.Q(A_1[node_num]);
-                double target = reward + gamma * node.Q(A_2[node_num]);
+                bool success = std::count(next.begin(), next.end(), next[node_num]) == 1;
+                reward = rewards.step(success, node.remaining_data) + idle;
+                double predict = node.Q(action[node_num]);
+                double target = reward + gamma * node.Q(next[node_num]);
                 delta = target - predict;
-                node.Q(A_1[node_num]) += alpha * delta * node.e_trace[node_num];
+                node.Q(action[node_num]) += alpha * delta * node.e_trace[node_num];
                 node.e_trace[node_num] *= gamma * ramda;
             }
 
@@ -213,27 +211,34 @@ private:
     // distribute reward at the end of an episode based on 
     // whether a node has finised transmission or not
     void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        double bonus = rewards.episode_bonus(nodes);
         for (auto& node : nodes) {
             int index = 0;
             node.Q.maxCoeff(&index);
-            if (node.is_success) {
-                node.Q[index] += episode_success;
-            }
-            else {
-                node.Q[index] += episode_failure;
-            }
+            node.Q[index] += rewards.final(node.is_success, bonus);
         }
     }
 
 
-    // rendering which node decided to transmit on which slot
+    // trace which node decided to transmit on which slot
     void render(int step) {
-#ifdef DEBUG
-        printf("Step #%d ", step);
-        for (auto i : A_1) {
-            printf("%2d ", i);
+        TRACE_INSTANT(2, "frame", "step", step);
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "action", "node", node.node_num, "slot", A_1()[node.node_num]);
+        }
+#endif
+    }
+
+    // trace the greedy slot of every node
+    void trace_policy() {
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            int index = 0;
+            node.Q.maxCoeff(&index);
+            TRACE_INSTANT(3, "policy", "node", node.node_num, "slot", index);
         }
-        printf("\n");
 #endif
     }
 
@@ -254,9 +259,10 @@ private:
     }
 
     void calc_average() {
-        std::for_each(data.success_frame.begin(), data.success_frame.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.success_data.begin(), data.success_data.end(), [](double& val) {val = val / iterations_target; });
-        std::for_each(data.success_node.begin(), data.success_node.end(), [](double& val) {val = val / iterations_target; });
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
     }
 
     void reset(bool episode_end) {
@@ -267,12 +273,17 @@ private:
     }
 
     inline double get_epsilon() {
-        return epsilon / episode_num;
+        return explore[episode_num];
     }
     NodeArr nodes;
-    Action A_1, A_2;
-    Action returns[frame_num_target + 1];
+    // A_1() and A_2() are the two halves of a double buffer, swapped by flipping `current`
+    std::array<Action, 2> actions;
+    int current = 0;
+    Action& A_1() { return actions[current]; }
+    Action& A_2() { return actions[current ^ 1]; }
     Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
 
     std::string plot_str;
 
@@ -283,6 +294,7 @@ private:
     double gamma = 0.6;
     double alpha = 0.1;
     double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
 
 
 
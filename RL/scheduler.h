@@ -0,0 +1,257 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <exception>
+
+#include "include.h"
+#include "cache.h"
+
+// Work-stealing pool for sweep tasks
+// Submitted tasks are sorted by their estimated cost and dealt round-robin to one deque per worker.
+// A worker takes the most expensive task left in its own deque, and once that runs dry steals the
+// cheapest task of another worker, so long tasks start early and short ones fill the gaps.
+class Scheduler {
+public:
+    explicit Scheduler(int num_threads = 0) {
+        if (num_threads <= 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (int w = 0; w < num_threads; w++) {
+            queues.emplace_back(new Queue);
+        }
+    }
+    int threads() const {
+        return static_cast<int>(queues.size());
+    }
+    // `cost` is an estimate in any unit, only the order of costs matters
+    void submit(std::function<void()> task, double cost = 1.0) {
+        pending.push_back({ std::move(task), cost });
+    }
+    // run every submitted task, this thread joins in as worker 0
+    // the first exception a task throws is rethrown once all workers have stopped
+    void run() {
+        std::stable_sort(pending.begin(), pending.end(), [](const Task& a, const Task& b) { return a.cost > b.cost; });
+        for (size_t i = 0; i < pending.size(); i++) {
+            queues[i % queues.size()]->tasks.push_back(std::move(pending[i]));
+        }
+        pending.clear();
+        error = nullptr;
+
+        std::vector<std::thread> workers;
+        for (int w = 1; w < threads(); w++) {
+            workers.emplace_back(&Scheduler::work, this, w);
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    struct Task {
+        std::function<void()> run;
+        double cost;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(int w, Task& task) {
+        auto& queue = *queues[w];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    bool steal(int w, Task& task) {
+        for (int i = 1; i < threads(); i++) {
+            auto& queue = *queues[(w + i) % threads()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    // Tasks never submit tasks, so once neither pop nor steal finds one nothing is left to start and
+    // the worker stops. run() joins the others, which waits for the tasks still running.
+    void work(int w) {
+        Task task;
+        while (pop(w, task) || steal(w, task)) {
+            try {
+                task.run();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<Task> pending;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+// A set of learner configurations trained as (learner, config, iterations) tasks on a Scheduler
+// Every job's iterations are cut into chunks of about equal cost across jobs, each chunk trains a
+// fresh learner and writes its Plot_Data to a slot fixed by (job, chunk). The chunks are merged
+// in chunk order afterwards, so the averages do not depend on which thread ran what.
+// With a Result_Cache, jobs that have a key are looked up before planning and never train when
+// found. The others are stored once merged.
+class Sweep {
+public:
+    // `make` returns a new learner with train(), set_iterations() and get_data(),
+    // `cost` is the estimated cost of one of its iterations relative to the other jobs
+    template <typename Make>
+    void add(const std::string& label, double cost, Make make, int iterations = iterations_target) {
+        Job job;
+        job.label = label;
+        job.cost = cost;
+        job.iterations = iterations;
+        job.train = [make](int count) {
+            auto learner = make();
+            learner.set_iterations(count);
+            learner.train();
+            return learner.get_data();
+        };
+        jobs.push_back(std::move(job));
+    }
+    // `learner` names the learner type and its parameters for result_key(), jobs without one are not cached
+    void set_key(int job, const std::string& learner) {
+        jobs[job].key = learner;
+    }
+    // network the job simulates, for the baselines, `nodes` 0 if its population changes over an episode
+    void set_sizes(int job, int nodes, int slots) {
+        jobs[job].nodes = nodes;
+        jobs[job].slots = slots;
+    }
+    void set_cache(Result_Cache* results) {
+        cache = results;
+    }
+
+    void run(Scheduler& scheduler) {
+        plan(scheduler.threads());
+        for (int j = 0; j < size(); j++) {
+            for (int c = 0; c < chunks(j); c++) {
+                scheduler.submit([this, j, c] { run_chunk(j, c); }, chunk_cost(j, c));
+            }
+        }
+        scheduler.run();
+        merge();
+    }
+
+    // Cut every job that is not cached into chunks for `workers` workers and clear their result slots
+    void plan(int workers) {
+        double total = 0.0;
+        for (auto& job : jobs) {
+            job.cached = cache && !job.key.empty() && cache->load(result_key(job.key, job.iterations), job.result);
+            job.chunk_sizes.clear();
+            job.chunks.clear();
+            if (!job.cached) {
+                total += job.cost * job.iterations;
+            }
+        }
+        double target = total / (std::max(1, workers) * sweep_tasks_per_thread);
+
+        for (auto& job : jobs) {
+            if (job.cached) continue;
+            int chunk = std::max(1, std::min(job.iterations, static_cast<int>(target / job.cost)));
+            for (int done = 0; done < job.iterations; done += chunk) {
+                job.chunk_sizes.push_back(std::min(chunk, job.iterations - done));
+            }
+            job.chunks.assign(job.chunk_sizes.size(), Plot_Data());
+        }
+    }
+    int chunks(int job) const {
+        return static_cast<int>(jobs[job].chunk_sizes.size());
+    }
+    double chunk_cost(int job, int chunk) const {
+        return jobs[job].cost * jobs[job].chunk_sizes[chunk];
+    }
+    // train the iterations of one chunk into its slot
+    void run_chunk(int job, int chunk) {
+        jobs[job].chunks[chunk] = jobs[job].train(jobs[job].chunk_sizes[chunk]);
+    }
+    Plot_Data& chunk_data(int job, int chunk) {
+        return jobs[job].chunks[chunk];
+    }
+    // chunk averages weighted by their iteration count, in chunk order
+    void merge() {
+        for (auto& job : jobs) {
+            if (job.cached) continue;
+            job.result = Plot_Data();
+            for (size_t c = 0; c < job.chunks.size(); c++) {
+                double weight = static_cast<double>(job.chunk_sizes[c]) / job.iterations;
+                add_weighted(job.result.success_frame, job.chunks[c].success_frame, weight);
+                add_weighted(job.result.success_data, job.chunks[c].success_data, weight);
+                add_weighted(job.result.success_node, job.chunks[c].success_node, weight);
+                add_weighted(job.result.cum_reward, job.chunks[c].cum_reward, weight);
+            }
+            job.chunks.clear();
+            if (cache && !job.key.empty()) {
+                cache->store(result_key(job.key, job.iterations), job.result);
+            }
+        }
+    }
+
+    int size() const {
+        return static_cast<int>(jobs.size());
+    }
+    const std::string& label(int job) const {
+        return jobs[job].label;
+    }
+    const Plot_Data& result(int job) const {
+        return jobs[job].result;
+    }
+    int nodes(int job) const {
+        return jobs[job].nodes;
+    }
+    int slots(int job) const {
+        return jobs[job].slots;
+    }
+    void plot() const {
+        plt::subplot(1, 1, 1);
+        for (auto& job : jobs) {
+            plt::named_plot(job.label, job.result.episodes, job.result.cum_reward);
+        }
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+private:
+    struct Job {
+        std::string label;
+        double cost;
+        int iterations;
+        std::function<Plot_Data(int)> train;
+        int nodes = NumNode;
+        int slots = NumSlot;
+        std::vector<int> chunk_sizes;
+        std::vector<Plot_Data> chunks;      // averages of each chunk, slot fixed before running
+        Plot_Data result;
+        std::string key;                    // learner for result_key(), empty if never cached
+        bool cached = false;                // result loaded by the last plan()
+    };
+
+    static void add_weighted(std::vector<double>& sum, const std::vector<double>& val, double weight) {
+        for (size_t i = 0; i < sum.size(); i++) {
+            sum[i] += val[i] * weight;
+        }
+    }
+
+    std::vector<Job> jobs;
+    Result_Cache* cache = nullptr;
+};
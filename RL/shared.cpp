@@ -0,0 +1,2 @@
+#include "shared.h"
+constexpr int SlottedAlohaRL_Shared::NumRow;
\ No newline at end of file
@@ -0,0 +1,331 @@
+#pragma once
+#include "include.h"
+#include "observation.h"
+
+// Parameter sharing: every node acts from one Q table
+// The table has a row per observed state, shared by all nodes, and optionally shared_id_buckets
+// node id rows so Q(node, state) = T(state) + T(NumState + node % shared_id_buckets).
+// Its size does not depend on the number of nodes.
+// Nodes are split into shared_shards shards. A shard reads the table and adds its TD updates to
+// its own gradient buffer, the buffers are merged into the table every shared_merge_frames frames
+// and at the end of every episode. Between merges shards never write shared memory.
+class SlottedAlohaRL_Shared {
+public:
+    static constexpr int NumRow = NumState + shared_id_buckets;
+
+    SlottedAlohaRL_Shared(const double& epsilon = 0.1, bool conditioned = true, const double& alpha = 0.1, const double& gamma = 0.6) :
+        epsilon(epsilon), alpha(alpha), gamma(gamma), conditioned(conditioned)
+    {
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(2) << epsilon;
+        plot_str = std::string(conditioned ? "Shared TD+id" : "Shared TD") + "(e=" + stream.str() + ")";
+        int i = 0;
+        for (auto& node : nodes) {
+            node.node_num = i++;
+        }
+        for (int s = 0; s < shared_shards; s++) {
+            shards[s].begin = s * NumNode / shared_shards;
+            shards[s].end = (s + 1) * NumNode / shared_shards;
+            shards[s].delta = Q_Table::Zero(NumRow, NumSlot);
+        }
+        reset_T();
+    }
+    void run() {
+        train();
+        profile::report(plot_str);
+        plot();
+    }
+    void train() {
+        std::ios::sync_with_stdio(false);
+        for (int i = 0; i < iterations; i++) {
+            run_iteration();
+            change_seed();
+            reset(true);
+        }
+        calc_average();
+    }
+    const Plot_Data& get_data() const {
+        return data;
+    }
+    // Number of iterations averaged by train(), iterations_target by default
+    void set_iterations(int count) {
+        iterations = std::max(1, count);
+    }
+
+private:
+    struct Node {
+        friend class SlottedAlohaRL_Shared;
+    public:
+        unsigned int node_num;
+        unsigned int remaining_data = data_target;
+        bool is_success = false;
+        Outcome last_outcome = Outcome::Idle;
+
+        void reset() {
+            remaining_data = data_target;
+            is_success = false;
+            last_outcome = Outcome::Idle;
+        }
+    };
+
+    typedef std::array<int, NumNode> State;
+    typedef std::array<int, NumNode> Action;
+    typedef std::array<Node, NumNode> NodeArr;
+    typedef std::array<double, NumNode> Reward;
+    typedef std::array<bool, NumNode> Mask;
+    typedef Matrix<double, Dynamic, NumSlot, RowMajor> Q_Table;
+
+    // nodes [begin, end) and the updates they made since the last merge
+    struct Shard {
+        int begin;
+        int end;
+        Q_Table delta;
+    };
+
+    void run_iteration() {
+        for (episode_num = 0; episode_num < episode_num_target; episode_num++) {
+            run_episode();
+        }
+    }
+
+    void run_episode() {
+        TRACE_BEGIN(1, "episode", "episode", episode_num);
+        observe(0, S_1());
+        choose_action(S_1(), A_1());
+
+        for (frame_num = 0; frame_num < frame_num_target; frame_num++) {
+            Reward reward = { 0.0 };
+            Mask active = { false };
+            check_collision(A_1(), reward, active);
+            observe(frame_num + 1, S_2());
+            choose_action(S_2(), A_2());
+            update(reward, active);
+            if ((frame_num + 1) % shared_merge_frames == 0) {
+                merge();
+            }
+            render(frame_num);
+            current ^= 1;
+        }
+
+        bool is_complete = true;
+        for (auto& node : nodes) {
+            node.is_success ? ++success_node : is_complete = false;
+        }
+        is_complete ? ++total_success : ++total_failure;
+        TRACE_COUNTER(1, "total_success", total_success);
+        TRACE_COUNTER(1, "total_failure", total_failure);
+        TRACE_END(1, "episode", "success_node", success_node, "complete", is_complete);
+
+        final_reward();
+        merge();
+        data.success_data[episode_num] += success_data;
+        data.success_node[episode_num] += success_node;
+        data.cum_reward[episode_num] += cur_reward;
+        success_data = 0;
+        success_node = 0;
+        cur_reward = 0;
+        for (auto& node : nodes) {
+            node.reset();
+        }
+    }
+
+    void observe(unsigned int frame, State& state) const {
+        for (auto& node : nodes) {
+            state[node.node_num] = observe_state(node.last_outcome, node.remaining_data, frame);
+        }
+    }
+
+    int id_row(int node_num) const {
+        return NumState + node_num % shared_id_buckets;
+    }
+    double value(int node_num, int state, int slot) const {
+        return conditioned ? T(state, slot) + T(id_row(node_num), slot) : T(state, slot);
+    }
+    int greedy_slot(int node_num, int state) const {
+        int index;
+        if (conditioned) {
+            (T.row(state) + T.row(id_row(node_num))).maxCoeff(&index);
+        }
+        else {
+            T.row(state).maxCoeff(&index);
+        }
+        return index;
+    }
+
+    void choose_action(const State& state, Action& action) {
+        PROFILE_SCOPE(Choose_Action);
+        for (auto& node : nodes) {
+            auto nn = node.node_num;
+            if (node.is_success) {
+                action[nn] = -1;
+                continue;
+            }
+            if (explore[episode_num] >= get_rand_real(0, 1)) {
+                action[nn] = get_rand_int(0, NumSlot - 1);
+            }
+            else {
+                action[nn] = greedy_slot(nn, state[nn]);
+            }
+        }
+    }
+
+    void check_collision(const Action& action, Reward& reward, Mask& active) {
+        PROFILE_SCOPE(Collision);
+        double idle = rewards.idle(action);
+        for (auto& node : nodes) {
+            if (node.remaining_data != 0) {
+                auto nn = node.node_num;
+                active[nn] = true;
+                // collision X
+                bool success = std::count(action.begin(), action.end(), action[nn]) == 1;
+                if (success) {
+                    node.last_outcome = Outcome::Success;
+                    --node.remaining_data;
+                    ++success_data;
+                    ++success_frame;
+                    if (node.remaining_data == 0) {
+                        node.is_success = true;
+                    }
+                }
+                // collision O
+                else {
+                    node.last_outcome = Outcome::Collision;
+                }
+                reward[nn] = rewards.step(success, node.remaining_data) + idle;
+            }
+        }
+        TRACE_COUNTER(2, "success_frame", success_frame);
+        data.success_frame[frame_num_data++] += success_frame;
+        success_frame = 0;
+    }
+
+    // step of `slot` towards `target` into the shard's buffer, split over the rows that make up the value
+    void accumulate(Shard& shard, int node_num, int state, int slot, double target) {
+        double step = alpha * (target - value(node_num, state, slot));
+        if (conditioned) {
+            shard.delta(state, slot) += step / 2;
+            shard.delta(id_row(node_num), slot) += step / 2;
+        }
+        else {
+            shard.delta(state, slot) += step;
+        }
+    }
+
+    // SARSA against the table as of the last merge
+    void update(const Reward& reward, const Mask& active) {
+        PROFILE_SCOPE(Update);
+        for (auto& shard : shards) {
+            for (int nn = shard.begin; nn < shard.end; nn++) {
+                if (!active[nn]) continue;
+                double target = reward[nn];
+                if (A_2()[nn] >= 0) {
+                    target += gamma * value(nn, S_2()[nn], A_2()[nn]);
+                }
+                accumulate(shard, nn, S_1()[nn], A_1()[nn], target);
+                cur_reward += reward[nn];
+            }
+        }
+    }
+
+    // terminal reward at the greedy slot of the state every node ended in
+    void final_reward() {
+        PROFILE_SCOPE(Final_Reward);
+        double bonus = rewards.episode_bonus(nodes);
+        for (auto& shard : shards) {
+            for (int nn = shard.begin; nn < shard.end; nn++) {
+                double reward = rewards.final(nodes[nn].is_success, bonus);
+                accumulate(shard, nn, S_1()[nn], greedy_slot(nn, S_1()[nn]), reward);
+                cur_reward += reward;
+            }
+        }
+    }
+
+    // sum every shard's buffer into the table and clear the buffers
+    void merge() {
+        for (auto& shard : shards) {
+            T += shard.delta;
+            shard.delta.setZero();
+        }
+    }
+
+    void render(int step) {
+        TRACE_INSTANT(2, "frame", "step", step);
+#if TRACE_LEVEL >= 3
+        for (auto& node : nodes) {
+            TRACE_INSTANT(3, "action", "node", node.node_num, "slot", A_1()[node.node_num]);
+        }
+#endif
+    }
+
+    void plot() {
+        plt::subplot(1, 1, 1);
+        plt::named_plot(plot_str, data.episodes, data.cum_reward);
+        plt::xlabel("# Episodes");
+        plt::ylabel("Cumulative Rewards");
+        plt::legend();
+    }
+
+    void calc_average() {
+        PROFILE_SCOPE(Calc_Average);
+        std::for_each(data.success_frame.begin(), data.success_frame.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_data.begin(), data.success_data.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.success_node.begin(), data.success_node.end(), [this](double& val) {val = val / iterations; });
+        std::for_each(data.cum_reward.begin(), data.cum_reward.end(), [this](double& val) {val = val / iterations; });
+    }
+
+    // Optimistic start in the rows that tell nodes apart, the id rows when there are any
+    void reset_T() {
+        T = Q_Table::Zero(NumRow, NumSlot);
+        int first = conditioned ? NumState : 0;
+        int rows = conditioned ? shared_id_buckets : NumState;
+        T.middleRows(first, rows) = Q_Table::Constant(rows, NumSlot, positive_feedback / (1 - gamma))
+                                    + 0.1 * Q_Table::Random(rows, NumSlot);
+    }
+
+    void reset(bool iteration_end) {
+        for (auto& node : nodes) {
+            node.reset();
+        }
+        if (iteration_end) {
+            reset_T();
+        }
+        frame_num_data = 0;
+        cur_reward = 0;
+    }
+
+    std::string plot_str;
+
+    NodeArr nodes;
+    // states and actions of the current and the next frame, a frame ends by flipping `current` instead of copying
+    std::array<State, 2> states;
+    std::array<Action, 2> actions;
+    int current = 0;
+    State& S_1() { return states[current]; }
+    State& S_2() { return states[current ^ 1]; }
+    Action& A_1() { return actions[current]; }
+    Action& A_2() { return actions[current ^ 1]; }
+    Plot_Data data;
+    Reward_Table rewards;
+    int iterations = iterations_target;
+
+    double epsilon = 0.1;
+    Exploration_Schedule explore{ epsilon };     // random action probability per episode
+    double alpha = 0.1;
+    double gamma = 0.6;
+    bool conditioned = true;
+
+    Q_Table T;                                  // shared table [NumRow x NumSlot]
+    std::array<Shard, shared_shards> shards;
+
+    int success_frame = 0;
+    int success_data = 0;
+    int success_node = 0;
+
+    unsigned int total_success = 0;
+    unsigned int total_failure = 0;
+    unsigned int frame_num = 0;
+    unsigned int frame_num_data = 0;
+    unsigned int episode_num = 0;
+
+    double cur_reward = 0;
+};
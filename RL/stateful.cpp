@@ -0,0 +1 @@
+#include "stateful.h"
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <random>
+#include <numeric>
+
+#include "global.h"
+
+// Fixed-size summaries for long-horizon runs
+// Every container here keeps the same amount of memory no matter how many episodes are pushed
+
+// mean of the last N samples
+template <int N>
+class Rolling_Mean {
+public:
+    void push(double val) {
+        sum += val - window[pos];
+        window[pos] = val;
+        pos = (pos + 1) % N;
+        if (count < N) ++count;
+    }
+    double mean() const {
+        return count == 0 ? 0.0 : sum / count;
+    }
+    void reset() {
+        window.fill(0.0);
+        sum = 0.0;
+        pos = 0;
+        count = 0;
+    }
+private:
+    std::array<double, N> window = { 0.0 };
+    double sum = 0.0;
+    int pos = 0;
+    int count = 0;
+};
+
+// Trace of at most N points covering the whole run
+// Each point is the mean of `stride` samples, when the buffer fills up
+// neighbouring points are merged and the stride doubles
+template <int N>
+class Decimated_Trace {
+    static_assert(N % 2 == 0, "Decimated_Trace needs an even size");
+public:
+    void push(double val) {
+        acc += val;
+        if (++acc_count < stride) return;
+        if (size == N) {
+            for (int i = 0; i < N / 2; i++) {
+                points[i] = (points[2 * i] + points[2 * i + 1]) / 2;
+            }
+            size = N / 2;
+            stride *= 2;
+            // the pending point only covers half of the new stride yet
+            return;
+        }
+        points[size++] = acc / acc_count;
+        acc = 0.0;
+        acc_count = 0;
+    }
+    // x axis (first sample of every point) and y axis for plotting
+    void get(std::vector<double>& x, std::vector<double>& y) const {
+        x.resize(size);
+        y.resize(size);
+        for (int i = 0; i < size; i++) {
+            x[i] = static_cast<double>(i) * stride;
+            y[i] = points[i];
+        }
+    }
+    void reset() {
+        size = 0;
+        stride = 1;
+        acc = 0.0;
+        acc_count = 0;
+    }
+private:
+    std::array<double, N> points = { 0.0 };
+    int size = 0;
+    unsigned long long stride = 1;
+    double acc = 0.0;
+    unsigned long long acc_count = 0;
+};
+
+// Uniform sample of N (index, value) pairs out of the whole run (Algorithm R)
+// Uses its own engine so sampling does not shift the learners' random sequence
+template <int N>
+class Reservoir {
+public:
+    void push(double val) {
+        if (seen < N) {
+            samples[seen] = { seen, val };
+        }
+        else {
+            std::uniform_int_distribution<unsigned long long> dist(0, seen);
+            auto j = dist(engine);
+            if (j < N) samples[j] = { seen, val };
+        }
+        ++seen;
+    }
+    // samples sorted by index for plotting
+    void get(std::vector<double>& x, std::vector<double>& y) const {
+        int size = seen < N ? static_cast<int>(seen) : N;
+        std::vector<std::pair<unsigned long long, double>> sorted(samples.begin(), samples.begin() + size);
+        std::sort(sorted.begin(), sorted.end());
+        x.resize(size);
+        y.resize(size);
+        for (int i = 0; i < size; i++) {
+            x[i] = static_cast<double>(sorted[i].first);
+            y[i] = sorted[i].second;
+        }
+    }
+    void reset() {
+        seen = 0;
+    }
+private:
+    std::array<std::pair<unsigned long long, double>, N> samples;
+    unsigned long long seen = 0;
+    std::minstd_rand engine{ 20210601u };
+};
+
+// rolling mean, decimated trace and reservoir of a single metric
+struct Stream_Metric {
+    Rolling_Mean<stream_window> rolling;
+    Decimated_Trace<stream_trace_size> trace;
+    Reservoir<stream_reservoir_size> reservoir;
+
+    void push(double val) {
+        rolling.push(val);
+        trace.push(val);
+        reservoir.push(val);
+    }
+    void reset() {
+        rolling.reset();
+        trace.reset();
+        reservoir.reset();
+    }
+};
+
+// Streaming counterpart of Plot_Data
+struct Stream_Data {
+    Stream_Metric success_frame;    // successful transmissions per step
+    Stream_Metric success_data;     // successful data transmitted per episode
+    Stream_Metric success_node;     // successful nodes per episode
+    Stream_Metric cum_reward;
+
+    unsigned long long episodes = 0;
+
+    void reset() {
+        success_frame.reset();
+        success_data.reset();
+        success_node.reset();
+        cum_reward.reset();
+        episodes = 0;
+    }
+};
@@ -0,0 +1,122 @@
+#pragma once
+// Structured tracing with compile-time levels
+//
+//   TRACE_LEVEL 0   off, every TRACE_* macro compiles to nothing (default)
+//   TRACE_LEVEL 1   episodes and run totals
+//   TRACE_LEVEL 2   + frames
+//   TRACE_LEVEL 3   + per-node actions and policies
+//
+// Events are appended as fixed-size binary records to a per-thread buffer, nothing is formatted
+// while the simulation runs. TRACE_WRITE(path) converts every buffer to Chrome trace JSON
+// afterwards, which can be opened in chrome://tracing or ui.perfetto.dev.
+// Names and argument names must be string literals.
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 0
+#endif
+
+#if TRACE_LEVEL > 0
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+namespace trace {
+
+struct Event {
+    int64_t ts;             // ns since the first event
+    const char* name;
+    const char* key[2];
+    int64_t val[2];
+    char phase;             // 'B'egin, 'E'nd, 'i'nstant, 'C'ounter
+};
+
+struct Buffer {
+    std::vector<Event> events;
+    unsigned int tid;
+};
+
+class Registry {
+public:
+    Registry() : start(std::chrono::steady_clock::now()) {}
+
+    Buffer* add_buffer() {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.emplace_back(new Buffer);
+        buffers.back()->tid = static_cast<unsigned int>(buffers.size() - 1);
+        buffers.back()->events.reserve(1 << 16);
+        return buffers.back().get();
+    }
+
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // should only be called while no other thread is tracing
+    void write_chrome_json(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ofstream out(path);
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (auto& buffer : buffers) {
+            for (auto& ev : buffer->events) {
+                out << (first ? "" : ",\n");
+                first = false;
+                out << "{\"name\":\"" << ev.name << "\",\"ph\":\"" << ev.phase << "\",\"ts\":" << ev.ts / 1000 << '.'
+                    << (ev.ts % 1000) / 100 << (ev.ts % 100) / 10 << ev.ts % 10
+                    << ",\"pid\":0,\"tid\":" << buffer->tid;
+                if (ev.phase == 'i') out << ",\"s\":\"t\"";
+                if (ev.key[0]) {
+                    out << ",\"args\":{\"" << ev.key[0] << "\":" << ev.val[0];
+                    if (ev.key[1]) out << ",\"" << ev.key[1] << "\":" << ev.val[1];
+                    out << '}';
+                }
+                out << '}';
+            }
+        }
+        out << "\n]}\n";
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+inline Registry& registry() {
+    static Registry reg;
+    return reg;
+}
+
+inline Buffer& buffer() {
+    static thread_local Buffer* buf = registry().add_buffer();
+    return *buf;
+}
+
+inline void emit(char phase, const char* name,
+                 const char* key0 = nullptr, int64_t val0 = 0,
+                 const char* key1 = nullptr, int64_t val1 = 0) {
+    buffer().events.push_back({ registry().now(), name, { key0, key1 }, { val0, val1 }, phase });
+}
+
+}   // namespace trace
+
+#define TRACE_BEGIN(level, name, ...)   do { if ((level) <= TRACE_LEVEL) trace::emit('B', name, ##__VA_ARGS__); } while (0)
+#define TRACE_END(level, name, ...)     do { if ((level) <= TRACE_LEVEL) trace::emit('E', name, ##__VA_ARGS__); } while (0)
+#define TRACE_INSTANT(level, name, ...) do { if ((level) <= TRACE_LEVEL) trace::emit('i', name, ##__VA_ARGS__); } while (0)
+#define TRACE_COUNTER(level, name, value) do { if ((level) <= TRACE_LEVEL) trace::emit('C', name, "value", (value)); } while (0)
+#define TRACE_WRITE(path) trace::registry().write_chrome_json(path)
+
+#else
+
+#define TRACE_BEGIN(level, name, ...)     ((void)0)
+#define TRACE_END(level, name, ...)       ((void)0)
+#define TRACE_INSTANT(level, name, ...)   ((void)0)
+#define TRACE_COUNTER(level, name, value) ((void)0)
+#define TRACE_WRITE(path)                 ((void)0)
+
+#endif
@@ -1,8 +1,12 @@
 #pragma once
 #include <random>
+#include <array>
+#include <cstdint>
 
-static std::random_device rd;
-static std::default_random_engine e(rd());
+// every thread draws from its own engine so learners can train side by side (see scheduler.h)
+static thread_local std::random_device rd;
+static thread_local unsigned int cur_seed = rd();
+static thread_local std::default_random_engine e(cur_seed);
 /*
 
 */
@@ -19,6 +23,44 @@ inline double get_rand_real(double min, double max) {
     return dist(e);
 }
 
-inline void change_seed() {
-    e = std::default_random_engine(rd());
-}
\ No newline at end of file
+inline void set_seed(unsigned int seed) {
+    cur_seed = seed;
+    e = std::default_random_engine(seed);
+}
+
+// the seed is kept so replay logs can reproduce an iteration
+inline unsigned int change_seed() {
+    set_seed(rd());
+    return cur_seed;
+}
+
+inline unsigned int get_seed() {
+    return cur_seed;
+}
+
+// `Size` independent xorshift32 streams, one float in (0, 1) per stream and call
+// The streams only shift and xor, so the fill loop has no carried dependency across lanes and
+// compiles to SIMD. They are seeded from the thread's engine, so a run is fixed by its seed.
+template <int Size>
+class Uniform_Lanes {
+public:
+    void seed() {
+        for (auto& s : state) {
+            s = static_cast<uint32_t>(e()) | 1u;
+        }
+    }
+    void fill(float* out) {
+        for (int i = 0; i < Size; i++) {
+            uint32_t s = state[i];
+            s ^= s << 13;
+            s ^= s >> 17;
+            s ^= s << 5;
+            state[i] = s;
+            // top 24 bits, centred in their interval so neither 0 nor 1 comes out
+            out[i] = (static_cast<float>(s >> 8) + 0.5f) * (1.0f / 16777216.0f);
+        }
+    }
+
+private:
+    std::array<uint32_t, Size> state;
+};